@@ -0,0 +1,176 @@
+#pragma once
+#include "GameEngine.h"
+
+// Benchmark runs. --record writes the input and clock of every main loop iteration to a
+// file, and --replay reads them back in place of the keyboard and the clock, so a walk
+// renders the same frames every time. --headless renders without a window, --frames stops
+// after that many frames and --dump writes each frame to a PPM. Runs that record or replay
+// keep the world pass at full size: dynamic resolution follows the wall clock, and picking
+// reads the rendered frame. Replays and headless runs render every frame, without idling
+// or music, and report frame times per level on exit.
+//
+// Recording file: "MMIR", Uint32 version, then per iteration Uint32 ticks, float dt,
+// Uint16 held keys, Uint16 press count and that many Uint16 scancodes, all little-endian.
+
+static const Uint32 RECORDING_VERSION = 1;
+
+struct LaunchOptions
+{
+    bool headless = false;
+    std::string recordPath, replayPath, dumpDir;
+    int frames = 0; // 0 = until quit or the end of the replay
+};
+
+// Input of one main loop iteration
+struct FrameInput
+{
+    Uint32 ticks = 0; // SDL_GetTicks, for the UI timers
+    float dt = 0.0f;
+    Uint16 held = 0;  // bit i set while HELD_KEYS[ i ] is down
+    std::vector<Uint16> presses; // key-down scancodes, in order
+};
+
+// Keys read as held rather than pressed (turning and walking)
+static const SDL_Scancode HELD_KEYS[] = { SDL_SCANCODE_LEFT, SDL_SCANCODE_RIGHT, SDL_SCANCODE_W, SDL_SCANCODE_S, SDL_SCANCODE_A, SDL_SCANCODE_D };
+static const int HELD_KEY_COUNT = int( sizeof( HELD_KEYS ) / sizeof( HELD_KEYS[ 0 ] ) );
+
+static bool keyHeld( const FrameInput &input, SDL_Scancode key ) {
+    for (int i = 0; i < HELD_KEY_COUNT; ++i)
+    {
+        if (HELD_KEYS[ i ] == key) return (input.held >> i) & 1;
+    }
+    return false;
+}
+
+static bool parseLaunchOptions( int argc, char **argv, LaunchOptions &options ) {
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[ i ];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--headless") options.headless = true;
+        else if (arg == "--record" && hasValue) options.recordPath = argv[ ++i ];
+        else if (arg == "--replay" && hasValue) options.replayPath = argv[ ++i ];
+        else if (arg == "--dump" && hasValue) options.dumpDir = argv[ ++i ];
+        else if (arg == "--frames" && hasValue) options.frames = std::max( 0, std::atoi( argv[ ++i ] ) );
+        else
+        {
+            std::fprintf( stderr, "Unknown or incomplete option %s\n", arg.c_str() );
+            std::fprintf( stderr, "Usage: [--headless] [--record file | --replay file] [--frames N] [--dump folder]\n" );
+            return false;
+        }
+    }
+    if (!options.recordPath.empty() && !options.replayPath.empty())
+    {
+        std::fprintf( stderr, "--record and --replay can't be used together\n" );
+        return false;
+    }
+    if (options.headless && options.replayPath.empty() && options.frames == 0)
+    {
+        std::fprintf( stderr, "--headless needs --replay or --frames to know when to stop\n" );
+        return false;
+    }
+    return true;
+}
+
+static void writeBytes( std::ofstream &out, Uint32 value, int bytes ) {
+    for (int i = 0; i < bytes; ++i) out.put( char( (value >> (8 * i)) & 0xFF ) );
+}
+
+static bool readBytes( std::ifstream &in, Uint32 &value, int bytes ) {
+    value = 0;
+    for (int i = 0; i < bytes; ++i)
+    {
+        const int c = in.get();
+        if (c == EOF) return false;
+        value |= Uint32( c ) << (8 * i);
+    }
+    return true;
+}
+
+static bool openRecording( std::ofstream &out, const std::string &path ) {
+    out.open( path, std::ios::binary );
+    if (!out)
+    {
+        std::fprintf( stderr, "Couldn't write %s\n", path.c_str() );
+        return false;
+    }
+    out.write( "MMIR", 4 );
+    writeBytes( out, RECORDING_VERSION, 4 );
+    return true;
+}
+
+static bool openReplay( std::ifstream &in, const std::string &path ) {
+    in.open( path, std::ios::binary );
+    char magic[ 4 ] = {};
+    Uint32 version = 0;
+    if (!in || !in.read( magic, 4 ) || std::string( magic, 4 ) != "MMIR" || !readBytes( in, version, 4 ) || version != RECORDING_VERSION)
+    {
+        std::fprintf( stderr, "%s is not a version %u input recording\n", path.c_str(), unsigned( RECORDING_VERSION ) );
+        return false;
+    }
+    return true;
+}
+
+static void writeFrameInput( std::ofstream &out, const FrameInput &input ) {
+    Uint32 dtBits;
+    std::memcpy( &dtBits, &input.dt, 4 );
+    writeBytes( out, input.ticks, 4 );
+    writeBytes( out, dtBits, 4 );
+    writeBytes( out, input.held, 2 );
+    writeBytes( out, Uint32( input.presses.size() ), 2 );
+    for (Uint16 key : input.presses) writeBytes( out, key, 2 );
+}
+
+// False at the end of the recording
+static bool readFrameInput( std::ifstream &in, FrameInput &input ) {
+    Uint32 dtBits, held, count;
+    if (!readBytes( in, input.ticks, 4 ) || !readBytes( in, dtBits, 4 ) || !readBytes( in, held, 2 ) || !readBytes( in, count, 2 )) return false;
+    std::memcpy( &input.dt, &dtBits, 4 );
+    input.held = Uint16( held );
+    input.presses.resize( count );
+    for (Uint16 &key : input.presses)
+    {
+        Uint32 value;
+        if (!readBytes( in, value, 2 )) return false;
+        key = Uint16( value );
+    }
+    return true;
+}
+
+// Binary PPM of a finished RENDER_W x RENDER_H frame
+static bool writePPM( const std::string &path, const std::vector<Uint32> &frame ) {
+    std::ofstream out( path, std::ios::binary );
+    if (!out)
+    {
+        std::fprintf( stderr, "Couldn't write %s\n", path.c_str() );
+        return false;
+    }
+    out << "P6\n" << RENDER_W << " " << RENDER_H << "\n255\n";
+    std::vector<char> row( RENDER_W * 3 );
+    for (int y = 0; y < RENDER_H; ++y)
+    {
+        for (int x = 0; x < RENDER_W; ++x)
+        {
+            const Uint32 color = frame[ y * RENDER_W + x ];
+            row[ 3 * x ] = char( (color >> 16) & 0xFF );
+            row[ 3 * x + 1 ] = char( (color >> 8) & 0xFF );
+            row[ 3 * x + 2 ] = char( color & 0xFF );
+        }
+        out.write( row.data(), row.size() );
+    }
+    return bool( out );
+}
+
+// Min, median and 99th percentile frame time of each level that rendered frames
+static void reportFrameTimes( std::vector<std::vector<float>> frameTimes, const std::vector<std::string> &levelNames ) {
+    for (size_t level = 0; level < frameTimes.size(); ++level)
+    {
+        auto &times = frameTimes[ level ];
+        if (times.empty()) continue;
+        std::sort( times.begin(), times.end() );
+        const size_t count = times.size();
+        const size_t p99 = std::min( count - 1, size_t( std::ceil( 0.99 * count ) ) - 1 );
+        std::printf( "%s: %zu frames, min %.2f ms, median %.2f ms, p99 %.2f ms\n",
+            levelNames[ level ].c_str(), count, times.front(), times[ count / 2 ], times[ p99 ] );
+    }
+}
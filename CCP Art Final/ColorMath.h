@@ -0,0 +1,117 @@
+#pragma once
+#include "Includes.h"
+
+// Integer color math on packed ARGB8888. Multipliers are 8.8 fixed point (256 = 1.0),
+// results saturate at 255 per channel and come back opaque, like rgb(). Textures with
+// transparency are premultiplied, so blending is src + dst * (1 - alpha).
+//
+// Scalar: R and B share one 32-bit multiply and G gets the other, which is exact while
+// the multiplier is <= 1.0; brighter multipliers fall back to per-channel saturation.
+// SSE2: channels are widened to c << 8 in 16-bit lanes and multiplied with mulhi, so
+// (c * m) >> 8 never overflows and packus does the saturation.
+
+// Multiplier for brightening/darkening factors (clamped to 0..4)
+inline int toMul88( float m ) {
+    return int( std::clamp( m, 0.0f, 4.0f ) * 256.0f );
+}
+
+// Multiplier for shade factors, which never brighten (clamped to 0..1)
+inline int toShade88( float shade ) {
+    return int( std::clamp( shade, 0.0f, 1.0f ) * 256.0f );
+}
+
+// Multiplier for a 0..255 byte that means v / 255 (255 = unchanged)
+inline int byteToMul88( int v ) {
+    return (v * 257 + 128) >> 8;
+}
+
+// Product of two 8.8 multipliers
+inline int mulMul88( int a, int b ) {
+    return (a * b) >> 8;
+}
+
+inline Uint32 colorMul( Uint32 c, int m88 ) {
+    if (m88 <= 256)
+    {
+        Uint32 rb = (((c & 0x00FF00FFu) * Uint32( m88 )) >> 8) & 0x00FF00FFu;
+        Uint32 g = (((c & 0x0000FF00u) * Uint32( m88 )) >> 8) & 0x0000FF00u;
+        return 0xFF000000u | rb | g;
+    }
+    Uint32 r = std::min( 255u, (((c >> 16) & 255) * Uint32( m88 )) >> 8 );
+    Uint32 g = std::min( 255u, (((c >> 8) & 255) * Uint32( m88 )) >> 8 );
+    Uint32 b = std::min( 255u, ((c & 255) * Uint32( m88 )) >> 8 );
+    return 0xFF000000u | (r << 16) | (g << 8) | b;
+}
+
+// Separate multiplier per channel (tinting)
+inline Uint32 colorMulRGB( Uint32 c, int r88, int g88, int b88 ) {
+    Uint32 r = std::min( 255u, (((c >> 16) & 255) * Uint32( r88 )) >> 8 );
+    Uint32 g = std::min( 255u, (((c >> 8) & 255) * Uint32( g88 )) >> 8 );
+    Uint32 b = std::min( 255u, ((c & 255) * Uint32( b88 )) >> 8 );
+    return 0xFF000000u | (r << 16) | (g << 8) | b;
+}
+
+// Premultiplied src over dst, where src covers alpha / 255 of the pixel
+inline Uint32 colorBlendOver( Uint32 dst, Uint32 src, int alpha ) {
+    if (alpha >= 255) return src | 0xFF000000u;
+    Uint32 under = colorMul( dst, 256 - alpha - (alpha >> 7) );
+    // Sums only pass 255 by rounding, but saturate anyway
+    Uint32 r = std::min( 255u, ((under >> 16) & 255) + ((src >> 16) & 255) );
+    Uint32 g = std::min( 255u, ((under >> 8) & 255) + ((src >> 8) & 255) );
+    Uint32 b = std::min( 255u, (under & 255) + (src & 255) );
+    return 0xFF000000u | (r << 16) | (g << 8) | b;
+}
+
+// Opaque color of a premultiplied texel (0 when fully transparent)
+inline Uint32 colorUnpremultiply( Uint32 c ) {
+    Uint32 a = c >> 24;
+    if (a == 255) return c;
+    if (a == 0) return 0;
+    Uint32 r = std::min( 255u, (((c >> 16) & 255) * 255 + a / 2) / a );
+    Uint32 g = std::min( 255u, (((c >> 8) & 255) * 255 + a / 2) / a );
+    Uint32 b = std::min( 255u, ((c & 255) * 255 + a / 2) / a );
+    return 0xFF000000u | (r << 16) | (g << 8) | b;
+}
+
+// Rec.601 luma in 0..255
+inline int colorLuma( Uint32 c ) {
+    return int( (((c >> 16) & 255) * 77 + ((c >> 8) & 255) * 150 + (c & 255) * 29) >> 8 );
+}
+
+// RGB565 storage: channels round to 5/6/5 bits and expand back by bit replication,
+// so black, white and pure magenta survive the round trip exactly
+inline Uint16 toRGB565( Uint32 c ) {
+    Uint32 r = ((((c >> 16) & 255) * 31 + 127) / 255);
+    Uint32 g = ((((c >> 8) & 255) * 63 + 127) / 255);
+    Uint32 b = (((c & 255) * 31 + 127) / 255);
+    return Uint16( (r << 11) | (g << 5) | b );
+}
+
+inline Uint32 fromRGB565( Uint16 p ) {
+    Uint32 r = (p >> 11) & 31, g = (p >> 5) & 63, b = p & 31;
+    return 0xFF000000u | ((r << 3) | (r >> 2)) << 16 | ((g << 2) | (g >> 4)) << 8 | ((b << 3) | (b >> 2));
+}
+
+#if HAS_SSE2
+// Four pixels times a multiplier given in every 16-bit lane of m88
+inline __m128i colorMul4( __m128i c, __m128i m88 ) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_mulhi_epu16( _mm_unpacklo_epi8( zero, c ), m88 );
+    __m128i hi = _mm_mulhi_epu16( _mm_unpackhi_epi8( zero, c ), m88 );
+    return _mm_or_si128( _mm_packus_epi16( lo, hi ), _mm_set1_epi32( int( 0xFF000000u ) ) );
+}
+#endif
+
+// count pixels in place
+inline void colorMulSpan( Uint32 *pixels, int count, int m88 ) {
+    int i = 0;
+#if HAS_SSE2
+    const __m128i m = _mm_set1_epi16( short( Uint16( m88 ) ) );
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i *p = (__m128i *)(pixels + i);
+        _mm_storeu_si128( p, colorMul4( _mm_loadu_si128( p ), m ) );
+    }
+#endif
+    for (; i < count; ++i) pixels[ i ] = colorMul( pixels[ i ], m88 );
+}
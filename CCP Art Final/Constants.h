@@ -1,5 +1,6 @@
 #pragma once 
 #include <cmath>
+// Full frame size; the world pass may run smaller (Engine::renderW, renderH)
 static const int RENDER_W = 960;      
 static const int RENDER_H = 540;
 static const int WIN_SCALE = 2;   
@@ -9,6 +10,35 @@ static const int WIN_SCALE = 2;
 //static const int RENDER_H = 1080;
 //static const int WIN_SCALE = 1;      
 
+// Dynamic resolution steps, in eighths of RENDER_W x RENDER_H: width and height take
+// turns going down, to half size on each axis
+static const int RESOLUTION_STEPS = 9;
+static const int RESOLUTION_EIGHTHS[ RESOLUTION_STEPS ][ 2 ] = { { 8, 8 }, { 7, 8 }, { 7, 7 }, { 6, 7 }, { 6, 6 }, { 5, 6 }, { 5, 5 }, { 4, 5 }, { 4, 4 } };
+
+// Width of the column strips handed to the render workers
+static const int RENDER_STRIP_W = 32;
+
+// Precomputed lighting: shade levels per texture, distance table resolution and range
+static const int LIGHT_LEVELS = 32;
+static const int LIGHT_DIST_SCALE = 16;
+static const float LIGHT_DIST_MAX = 64.0f;
+
+// Surface cache: largest baked face texture per axis, and faces baked per frame
+static const int SURFACE_MAX_SIZE = 1024;
+static const int SURFACE_BAKES_PER_FRAME = 1;
+
+// Visibility precomputation: sample points per tile axis, and rays cast from each point
+static const int VISIBILITY_SAMPLES = 3;
+static const int VISIBILITY_RAYS = 512;
+
+// UI timers: the statue chat runs this long before the transition, and an open placard
+// closes this long after the crosshair leaves it
+static const int STATUE_CHAT_MS = 8000;
+static const int PLACARD_KEEP_MS = 600;
+
+// Longest sleep of the idle main loop; music is checked when it wakes
+static const int IDLE_WAKE_MS = 250;
+
 static const float FOV = 60.0f * (3.14159265f / 180.0f);
 static const float FOV_TAN = std::tan( FOV * 0.5f );
 static const float MOVE_SPEED = 1.8f; // units/sec
@@ -0,0 +1,83 @@
+#pragma once
+#include "GameEngine.h"
+
+// Dynamic resolution. The world pass renders renderW x renderH, and finishRender stretches
+// it to the full RENDER_W x RENDER_H frame before the UI is drawn, so text stays sharp and
+// SDL scales the frame to the window as before. The pass is timed from after the surface
+// cache bakes (they don't depend on the size) until its last strip finishes, and smoothed
+// over frames. Over budget steps the size down, under 3/4 of the budget steps it back up,
+// with a cooldown in between so it settles instead of bouncing.
+
+static void setResolutionLevel( Engine &engineContext, int level ) {
+    auto &res = engineContext.resolution;
+    res.level = std::clamp( level, 0, RESOLUTION_STEPS - 1 );
+    engineContext.renderW = RENDER_W * RESOLUTION_EIGHTHS[ res.level ][ 0 ] / 8;
+    engineContext.renderH = RENDER_H * RESOLUTION_EIGHTHS[ res.level ][ 1 ] / 8;
+}
+
+// Steps to another size and holds it for a while. Pass time follows the pixel count, so
+// expect that much at the new size.
+static void changeResolutionLevel( Engine &engineContext, int level ) {
+    auto &res = engineContext.resolution;
+    if (level == res.level) return;
+    const float pixelsBefore = float( engineContext.renderW ) * float( engineContext.renderH );
+    setResolutionLevel( engineContext, level );
+    res.averageMs *= float( engineContext.renderW ) * float( engineContext.renderH ) / pixelsBefore;
+    res.cooldown = 10;
+}
+
+// Picks the size of the next world pass from the time of the last one
+static void updateResolution( Engine &engineContext ) {
+    auto &res = engineContext.resolution;
+    if (!config::dynamicResolution)
+    {
+        if (res.level != 0) setResolutionLevel( engineContext, 0 );
+        return;
+    }
+    if (res.passEnd <= res.passStart) return; // no finished pass yet
+
+    const float ms = std::chrono::duration<float, std::milli>( res.passEnd - res.passStart ).count();
+    res.averageMs = (res.averageMs > 0.0f) ? res.averageMs * 0.9f + ms * 0.1f : ms;
+    if (res.cooldown > 0)
+    {
+        --res.cooldown;
+        return;
+    }
+
+    int level = res.level;
+    if (res.averageMs > config::frameBudgetMs) ++level;
+    else if (res.averageMs < 0.75f * config::frameBudgetMs) --level;
+    changeResolutionLevel( engineContext, std::clamp( level, 0, RESOLUTION_STEPS - 1 ) );
+}
+
+// Nearest-neighbour stretch of worldFrame to the backbuffer, in row bands on the workers.
+// Rows that repeat the previous source row are copied from the row above.
+static void upscaleWorld( Engine &engineContext ) {
+    const int srcW = engineContext.renderW, srcH = engineContext.renderH;
+    const Uint32 *src = engineContext.worldFrame.data();
+    Uint32 *dst = engineContext.backbuffer.data();
+    const int xStep = (srcW << 16) / RENDER_W; // 16.16 source columns per output column
+
+    const int BAND_ROWS = 32;
+    const int bandCount = (RENDER_H + BAND_ROWS - 1) / BAND_ROWS;
+    engineContext.workers.run( bandCount, [=]( int band, int ) {
+        const int yBegin = band * BAND_ROWS;
+        const int yEnd = std::min( RENDER_H, yBegin + BAND_ROWS );
+        int lastRow = -1;
+        for (int y = yBegin; y < yEnd; ++y)
+        {
+            Uint32 *out = dst + y * RENDER_W;
+            const int sy = y * srcH / RENDER_H;
+            if (sy == lastRow)
+            {
+                std::copy( out - RENDER_W, out, out );
+                continue;
+            }
+            lastRow = sy;
+
+            const Uint32 *in = src + sy * srcW;
+            int u = 0;
+            for (int x = 0; x < RENDER_W; ++x, u += xStep) out[ x ] = in[ u >> 16 ];
+        }
+        } );
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include "GameEngine.h"
+
+// Floor/ceiling span kernel: steps the world position in 16.16 fixed point, 8 pixels
+// per iteration, and shades in integer lanes. ARGB8888 texels are gathered with AVX2 when
+// the build enables it, otherwise (and for RGB565/INDEXED8 textures) with scalar loads.
+//
+// Tolerance against the old float path (fx = worldX - floor(worldX), tx = int(fx * w),
+// Uint8(c * shade)):
+//  - the texel coordinate comes from the 16-bit fraction, so on a texel boundary it can
+//    land on the neighbouring texel (at most one texel off, never out of range)
+//  - shading is colorMul() with an 8.8 shade, which can be one below the float result
+//    per channel
+// The SSE2/AVX2 and scalar versions of this kernel are bit-identical to each other.
+
+// 16.16 fixed point from a float world coordinate
+inline int toFixed16( float v ) {
+    return int( std::llround( double( v ) * 65536.0 ) );
+}
+
+inline size_t floorTexelIndex( const Image &texture, int fixX, int fixY ) {
+    // Fraction * size >> 16 is always inside [0, size - 1]
+    Uint32 tx = (Uint32( fixX & 0xFFFF ) * Uint32( texture.width )) >> 16;
+    Uint32 ty = (Uint32( fixY & 0xFFFF ) * Uint32( texture.height )) >> 16;
+    return size_t( ty ) * texture.width + tx;
+}
+
+// drawFloorSpan for one texture format; fetch comes from Image::withFetch
+template <typename Fetch>
+static void drawFloorSpanFetch( const Image &texture, Fetch fetch, Uint32 *out, const int *clipTop, const int *clipBot, int y,
+    int xBegin, int xEnd, int fixX, int fixY, int stepX, int stepY, int shade88 ) {
+    int x = xBegin;
+    const bool shaded = shade88 < 256; // pre-shaded light banks come in at 256
+#if defined(__AVX2__)
+    const bool direct = texture.format == TextureFormat::ARGB8888; // compact formats expand per texel
+#endif
+
+#if HAS_SSE2
+    if (texture.width <= 0xFFFF && texture.height <= 0xFFFF)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i texW = _mm_set1_epi16( short( texture.width ) );
+        const __m128i texH = _mm_set1_epi16( short( texture.height ) );
+        const __m128i shade = _mm_set1_epi16( short( shade88 ) );
+        const __m128i rowY = _mm_set1_epi32( y );
+        const __m128i step8X = _mm_set1_epi32( stepX * 8 );
+        const __m128i step8Y = _mm_set1_epi32( stepY * 8 );
+
+        __m128i posXLo = _mm_setr_epi32( fixX, fixX + stepX, fixX + 2 * stepX, fixX + 3 * stepX );
+        __m128i posYLo = _mm_setr_epi32( fixY, fixY + stepY, fixY + 2 * stepY, fixY + 3 * stepY );
+        __m128i posXHi = _mm_add_epi32( posXLo, _mm_set1_epi32( stepX * 4 ) );
+        __m128i posYHi = _mm_add_epi32( posYLo, _mm_set1_epi32( stepY * 4 ) );
+
+        // Low 16 bits of each 32-bit lane, packed into 8 x u16
+        auto fraction = []( __m128i lo, __m128i hi ) {
+            lo = _mm_srai_epi32( _mm_slli_epi32( lo, 16 ), 16 );
+            hi = _mm_srai_epi32( _mm_slli_epi32( hi, 16 ), 16 );
+            return _mm_packs_epi32( lo, hi );
+            };
+
+        for (; x + 8 <= xEnd; x += 8)
+        {
+            // Lanes that are not covered by a wall
+            __m128i keepLo = _mm_or_si128(
+                _mm_cmpgt_epi32( _mm_loadu_si128( (const __m128i *)(clipTop + x) ), rowY ),
+                _mm_cmpgt_epi32( rowY, _mm_loadu_si128( (const __m128i *)(clipBot + x) ) ) );
+            __m128i keepHi = _mm_or_si128(
+                _mm_cmpgt_epi32( _mm_loadu_si128( (const __m128i *)(clipTop + x + 4) ), rowY ),
+                _mm_cmpgt_epi32( rowY, _mm_loadu_si128( (const __m128i *)(clipBot + x + 4) ) ) );
+            int keepBits = _mm_movemask_epi8( keepLo ) | (_mm_movemask_epi8( keepHi ) << 16);
+
+            if (keepBits != 0)
+            {
+                __m128i tx = _mm_mulhi_epu16( fraction( posXLo, posXHi ), texW );
+                __m128i ty = _mm_mulhi_epu16( fraction( posYLo, posYHi ), texH );
+
+                // index = ty * width + tx as 32-bit lanes
+                __m128i rowLo16 = _mm_mullo_epi16( ty, texW );
+                __m128i rowHi16 = _mm_mulhi_epu16( ty, texW );
+                __m128i indexLo = _mm_add_epi32( _mm_unpacklo_epi16( rowLo16, rowHi16 ), _mm_unpacklo_epi16( tx, zero ) );
+                __m128i indexHi = _mm_add_epi32( _mm_unpackhi_epi16( rowLo16, rowHi16 ), _mm_unpackhi_epi16( tx, zero ) );
+
+                __m128i colorLo, colorHi;
+#if defined(__AVX2__)
+                if (direct)
+                {
+                    const int *texels = (const int *)texture.pixels.data();
+                    colorLo = _mm_i32gather_epi32( texels, indexLo, 4 );
+                    colorHi = _mm_i32gather_epi32( texels, indexHi, 4 );
+                }
+                else
+#endif
+                {
+                    alignas(16) int index[ 8 ];
+                    _mm_store_si128( (__m128i *)index, indexLo );
+                    _mm_store_si128( (__m128i *)(index + 4), indexHi );
+                    alignas(16) Uint32 texels[ 8 ];
+                    for (int k = 0; k < 8; ++k) texels[ k ] = fetch( index[ k ] );
+                    colorLo = _mm_load_si128( (const __m128i *)texels );
+                    colorHi = _mm_load_si128( (const __m128i *)(texels + 4) );
+                }
+                if (shaded)
+                {
+                    colorLo = colorMul4( colorLo, shade );
+                    colorHi = colorMul4( colorHi, shade );
+                }
+
+                __m128i *dst = (__m128i *)(out + (x - xBegin));
+                if (keepBits != -1)
+                {
+                    colorLo = _mm_or_si128( _mm_and_si128( keepLo, colorLo ), _mm_andnot_si128( keepLo, _mm_loadu_si128( dst ) ) );
+                    colorHi = _mm_or_si128( _mm_and_si128( keepHi, colorHi ), _mm_andnot_si128( keepHi, _mm_loadu_si128( dst + 1 ) ) );
+                }
+                _mm_storeu_si128( dst, colorLo );
+                _mm_storeu_si128( dst + 1, colorHi );
+            }
+
+            posXLo = _mm_add_epi32( posXLo, step8X );
+            posXHi = _mm_add_epi32( posXHi, step8X );
+            posYLo = _mm_add_epi32( posYLo, step8Y );
+            posYHi = _mm_add_epi32( posYHi, step8Y );
+        }
+
+        int done = x - xBegin;
+        fixX += stepX * done;
+        fixY += stepY * done;
+    }
+#endif
+
+    // Scalar tail (and the whole span without SSE2)
+    for (; x < xEnd; ++x)
+    {
+        if (y < clipTop[ x ] || y > clipBot[ x ])
+        {
+            Uint32 c = fetch( floorTexelIndex( texture, fixX, fixY ) );
+            out[ x - xBegin ] = shaded ? colorMul( c, shade88 ) : c;
+        }
+        fixX += stepX;
+        fixY += stepY;
+    }
+}
+
+// Draws row pixels [xBegin, xEnd) that fall outside the per-column wall span
+// [clipTop[x], clipBot[x]] into out[ 0 .. xEnd - xBegin ). fixX/fixY are the 16.16
+// world position at xBegin.
+// shade88 = 256 copies texels unshaded. colors is the light bank palette of an INDEXED8
+// texture (see Image::withFetch).
+static void drawFloorSpan( const Image &texture, const Uint32 *colors, Uint32 *out, const int *clipTop, const int *clipBot, int y,
+    int xBegin, int xEnd, int fixX, int fixY, int stepX, int stepY, int shade88 ) {
+    texture.withFetch( [&]( auto fetch ) {
+        drawFloorSpanFetch( texture, fetch, out, clipTop, clipBot, y, xBegin, xEnd, fixX, fixY, stepX, stepY, shade88 );
+        }, colors );
+}
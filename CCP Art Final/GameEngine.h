@@ -1,5 +1,8 @@
 #pragma once
 #include "Includes.h"
+#include "WorkerPool.h"
+#include "ColorMath.h"
+#include "Palette.h"
 namespace fs = std::filesystem;
 
 static inline Uint32 rgb( Uint8 r, Uint8 g, Uint8 b ) {
@@ -7,12 +10,45 @@ static inline Uint32 rgb( Uint8 r, Uint8 g, Uint8 b ) {
 }
 
 
+// Texel storage of an Image. The compact formats expand to ARGB8888 on fetch.
+enum class TextureFormat
+{
+    ARGB8888,
+    RGB565,   // 2 bytes per texel
+    INDEXED8  // 1 byte per texel into a palette of up to 256 ARGB8888 colors
+};
+
+// Which texels of a loaded image become transparent (see Image::keyToAlpha)
+enum class ColorKey
+{
+    MAGENTA,      // exactly 255, 0, 255
+    NEAR_MAGENTA, // within 120 of magenta, for billboards with soft key edges
+    NEAR_BLACK    // magenta, or every channel <= 120 (box face textures)
+};
+
+// Rows [begin, end) of one texture column that have some coverage
+struct TexelRun
+{
+    Uint16 begin = 0;
+    Uint16 end = 0;
+};
+
 struct Image
 {
     int width = 0;
     int height = 0;
-    std::vector<Uint32> pixels; // ARGB8888
+    TextureFormat format = TextureFormat::ARGB8888;
+    std::vector<Uint32> pixels;    // ARGB8888
+    std::vector<Uint16> pixels565; // RGB565
+    std::vector<Uint8> indices;    // INDEXED8
+    std::vector<Uint32> palette;   // INDEXED8
     int resolution = 1;
+    bool columnMajor = false; // texel index x * height + y, for textures drawn in vertical spans
+    bool hasAlpha = false;    // some texels are not opaque; colors are premultiplied
+    std::vector<Image> mips;  // box-filtered half-size levels 1..n (see buildMips)
+    std::string name;         // file name, for per-asset formats
+    std::vector<TexelRun> runs;      // covered rows per column, billboards and boxes only (see buildRuns)
+    std::vector<Uint32> columnRuns;  // column x owns runs[ columnRuns[ x ] .. columnRuns[ x + 1 ] )
     bool loadBMP( const std::string &path ) {
         // Use the map to create a surface
 
@@ -31,22 +67,265 @@ struct Image
             std::fprintf( stderr, "SDL_ConvertSurface failed for %s: %s\n", path.c_str(), SDL_GetError() );
             return false;
         }
-        // Set width, height, and copy pixel data
-        width = ColoredSurface->w;
-        height = ColoredSurface->h;
-        resolution = width * height;
-        pixels.resize( resolution );
+        // Set width, height, and copy pixel data (row-major ARGB8888, no mips yet)
+        fill( ColoredSurface->w, ColoredSurface->h, 0 );
         std::memcpy( pixels.data(), ColoredSurface->pixels, resolution * 4 );
         SDL_DestroySurface( ColoredSurface );
+        name = fs::path( path ).filename().string();
         return true;
     }
 
+    // Resets to a row-major ARGB8888 image of one color
+    void fill( int w, int h, Uint32 color ) {
+        width = w;
+        height = h;
+        resolution = width * height;
+        format = TextureFormat::ARGB8888;
+        pixels.assign( resolution, color );
+        pixels565.clear();
+        indices.clear();
+        palette.clear();
+        columnMajor = false;
+        hasAlpha = false;
+        mips.clear();
+        name.clear();
+        runs.clear();
+        columnRuns.clear();
+    }
+
+    // Texel at storage index i, expanded to ARGB8888. INDEXED8 texels read through colors
+    // when given (a light bank's shaded palette), else through palette.
+    Uint32 texel( size_t i, const Uint32 *colors = nullptr ) const {
+        switch (format)
+        {
+        case TextureFormat::RGB565: return fromRGB565( pixels565[ i ] );
+        case TextureFormat::INDEXED8: return (colors ? colors : palette.data())[ indices[ i ] ];
+        default: return pixels[ i ];
+        }
+    }
+
+    // Calls fn( fetch ) where fetch( i ) == texel( i, colors ), specialized per format, so
+    // a hot loop inside fn tests the format once instead of per texel
+    template <typename Fn>
+    void withFetch( Fn &&fn, const Uint32 *colors = nullptr ) const {
+        switch (format)
+        {
+        case TextureFormat::RGB565:
+        {
+            const Uint16 *texels = pixels565.data();
+            fn( [texels]( size_t i ) { return fromRGB565( texels[ i ] ); } );
+            break;
+        }
+        case TextureFormat::INDEXED8:
+        {
+            const Uint8 *texels = indices.data();
+            const Uint32 *lookup = colors ? colors : palette.data();
+            fn( [texels, lookup]( size_t i ) { return lookup[ texels[ i ] ]; } );
+            break;
+        }
+        default:
+        {
+            const Uint32 *texels = pixels.data();
+            fn( [texels]( size_t i ) { return texels[ i ]; } );
+            break;
+        }
+        }
+    }
+
     // Gets pixel color data at (x,y) snapping to nearest valid pixel if needed
-    Uint32 sample( int x, int y ) const {
+    Uint32 sample( int x, int y, const Uint32 *colors = nullptr ) const {
         x = std::clamp( x, 0, width - 1 );
         y = std::clamp( y, 0, height - 1 );
         // Convert from 2D to 1D index with row-major order using offset of x
-        return pixels[ y * width + x ];
+        return texel( columnMajor ? size_t( x ) * height + y : size_t( y ) * width + x, colors );
+    }
+
+    // Storage index of texel (x, 0); rows follow contiguously (column-major images only)
+    size_t columnStart( int x ) const {
+        return size_t( x ) * height;
+    }
+
+    // Transposes the texels so each column is contiguous
+    void makeColumnMajor() {
+        if (columnMajor) return;
+        auto transpose = [&]( auto &texels ) {
+            if (texels.empty()) return;
+            std::remove_reference_t<decltype(texels)> transposed( texels.size() );
+            for (int y = 0; y < height; ++y)
+            {
+                for (int x = 0; x < width; ++x)
+                {
+                    transposed[ size_t( x ) * height + y ] = texels[ size_t( y ) * width + x ];
+                }
+            }
+            texels.swap( transposed );
+            };
+        transpose( pixels );
+        transpose( pixels565 );
+        transpose( indices );
+        columnMajor = true;
+        for (auto &mip : mips) mip.makeColumnMajor();
+    }
+
+    // Re-stores an ARGB8888 image and its mips as RGB565 or INDEXED8. The palette is a
+    // median cut of the base level and the mips index into the same colors. RGB565 has no
+    // alpha, so images with transparency stay ARGB8888 there; INDEXED8 keeps one clear
+    // entry and rounds partly covered mip texels to clear or opaque.
+    void compress( TextureFormat target ) {
+        if (format != TextureFormat::ARGB8888 || target == TextureFormat::ARGB8888) return;
+        if (target == TextureFormat::RGB565 && hasAlpha)
+        {
+            std::fprintf( stderr, "%s has transparency, keeping it ARGB8888 instead of RGB565\n", name.c_str() );
+            return;
+        }
+
+        std::vector<Uint32> colors;
+        if (target == TextureFormat::INDEXED8)
+        {
+            colors.reserve( pixels.size() );
+            for (Uint32 c : pixels)
+            {
+                if ((c >> 24) == 255) colors.push_back( c );
+            }
+            colors = buildPalette( colors, hasAlpha ? 255 : 256 );
+            if (hasAlpha) colors.push_back( 0 );
+        }
+        encode( target, colors );
+        // INDEXED8 clears partly covered texels, which can shorten the runs
+        if (!columnRuns.empty()) buildRuns();
+    }
+
+    // Mip level lod (0 = this image), clamped to the chain
+    const Image &level( int lod ) const {
+        if (lod <= 0 || mips.empty()) return *this;
+        return mips[ std::min( lod, (int)mips.size() ) - 1 ];
+    }
+
+    // Level that samples about one texel per screen pixel at this minification
+    const Image &levelFor( float texelsPerPixel ) const {
+        int lod = 0;
+        while (texelsPerPixel >= 2.0f && lod < (int)mips.size())
+        {
+            texelsPerPixel *= 0.5f;
+            ++lod;
+        }
+        return level( lod );
+    }
+
+    static bool isKeyColor( Uint32 c, ColorKey key ) {
+        int r = (c >> 16) & 255, g = (c >> 8) & 255, b = c & 255;
+        bool magenta = r == 255 && g == 0 && b == 255;
+        switch (key)
+        {
+        case ColorKey::NEAR_MAGENTA: return r >= 135 && g <= 120 && b >= 135;
+        case ColorKey::NEAR_BLACK: return magenta || (r <= 120 && g <= 120 && b <= 120);
+        default: return magenta;
+        }
+    }
+
+    // Turns key colored texels into transparent black (alpha 0) once at load, so the
+    // renderers test alpha instead of color tolerances. Call before buildMips.
+    void keyToAlpha( ColorKey key ) {
+        for (Uint32 &c : pixels)
+        {
+            if (isKeyColor( c, key ))
+            {
+                c = 0;
+                hasAlpha = true;
+            }
+        }
+    }
+
+    // Builds the 2x2 box-filtered chain down to 1x1. All four channels average, which on
+    // premultiplied texels turns cut-out edges into partial coverage instead of key fringes.
+    // Mips come out in this image's layout and format.
+    void buildMips() {
+        mips.clear();
+
+        for (;;)
+        {
+            const Image *src = mips.empty() ? this : &mips.back();
+            if (src->width <= 1 && src->height <= 1) break;
+
+            Image mip;
+            mip.width = std::max( 1, src->width / 2 );
+            mip.height = std::max( 1, src->height / 2 );
+            mip.resolution = mip.width * mip.height;
+            mip.hasAlpha = hasAlpha;
+            mip.pixels.resize( mip.resolution );
+            for (int y = 0; y < mip.height; ++y)
+            {
+                for (int x = 0; x < mip.width; ++x)
+                {
+                    Uint32 quad[ 4 ] = { src->sample( 2 * x, 2 * y ), src->sample( 2 * x + 1, 2 * y ),
+                        src->sample( 2 * x, 2 * y + 1 ), src->sample( 2 * x + 1, 2 * y + 1 ) };
+                    Uint32 a = 0, r = 0, g = 0, b = 0;
+                    for (Uint32 c : quad)
+                    {
+                        a += c >> 24; r += (c >> 16) & 255; g += (c >> 8) & 255; b += c & 255;
+                    }
+                    mip.pixels[ y * mip.width + x ] = ((a + 2) / 4) << 24 | ((r + 2) / 4) << 16 | ((g + 2) / 4) << 8 | ((b + 2) / 4);
+                }
+            }
+            mips.push_back( std::move( mip ) );
+        }
+        for (auto &mip : mips)
+        {
+            mip.encode( format, palette );
+            if (columnMajor) mip.makeColumnMajor();
+        }
+    }
+
+    // Finds the runs of non-clear texels in every column of this image and its mips, so
+    // billboards and boxes can skip transparent stretches without testing each texel
+    void buildRuns() {
+        runs.clear();
+        columnRuns.assign( width + 1, 0 );
+        for (int x = 0; x < width; ++x)
+        {
+            columnRuns[ x ] = Uint32( runs.size() );
+            int y = 0;
+            while (y < height)
+            {
+                while (y < height && (sample( x, y ) >> 24) == 0) ++y;
+                if (y == height) break;
+                TexelRun run;
+                run.begin = Uint16( y );
+                while (y < height && (sample( x, y ) >> 24) != 0) ++y;
+                run.end = Uint16( y );
+                runs.push_back( run );
+            }
+        }
+        columnRuns[ width ] = Uint32( runs.size() );
+        for (auto &mip : mips) mip.buildRuns();
+    }
+
+    // ARGB8888 texels (in either layout) to target; INDEXED8 maps onto colors
+    void encode( TextureFormat target, const std::vector<Uint32> &colors ) {
+        if (format != TextureFormat::ARGB8888 || target == TextureFormat::ARGB8888) return;
+
+        if (target == TextureFormat::RGB565)
+        {
+            pixels565.resize( pixels.size() );
+            for (size_t i = 0; i < pixels.size(); ++i) pixels565[ i ] = toRGB565( pixels[ i ] );
+        }
+        else
+        {
+            // The clear entry (last, 0) is only for texels under half coverage; opaque
+            // texels match the other entries, or a dark one could come out clear
+            palette = colors;
+            const int clearIndex = (!palette.empty() && palette.back() == 0) ? (int)palette.size() - 1 : -1;
+            PaletteLookup lookup( palette, clearIndex >= 0 ? clearIndex : (int)palette.size() );
+            indices.resize( pixels.size() );
+            for (size_t i = 0; i < pixels.size(); ++i)
+            {
+                const Uint32 c = pixels[ i ];
+                indices[ i ] = (clearIndex >= 0 && (c >> 24) < 128) ? Uint8( clearIndex ) : lookup.nearest( colorUnpremultiply( c ) );
+            }
+        }
+        std::vector<Uint32>().swap( pixels );
+        format = target;
+        for (auto &mip : mips) mip.encode( target, colors );
     }
 };
 
@@ -120,6 +399,14 @@ struct Artwork
     float x = 1.5f, y = 1.5f;
 };
 
+// One wall-mounted artwork on a face, with its clamped u range along the face
+struct ArtworkSpan
+{
+    int artIndex = 0;
+    float u0 = 0.0f;
+    float u1 = 0.0f;
+};
+
 struct CaveArt : Artwork {
     float widthMultiplier;
     float heightMultiplier;
@@ -152,15 +439,29 @@ struct BoxProp
     // Orientation of the long axis in radians
     float angle = 0.f;
 
-    Image sideTexure;
+    // Handles into Engine::boxTextures; legs use the side texture when legTexture is -1
+    int sideTexture = -1;
+    int legTexture = -1;
 
-    Image legTexure;
+    // This box's run of Engine::boxFaces (see buildBoxFaces)
+    int firstFace = 0;
+    int faceCount = 0;
 
     float legHalf = 0.05f;     // ~10 cm
     float legInsetLength = 0.12f;   // inset along length
     float legInsetDepth = 0.08f;   // inset along depth
 };
 
+// One side of a box or of its legs, in world space
+struct BoxFace
+{
+    float ax = 0.f, ay = 0.f; // bottom edge, from a to b
+    float bx = 0.f, by = 0.f;
+    float height = 0.f;
+    int texture = 0; // into Engine::boxTextures
+    bool solid = false; // texture has no holes to see the back faces through
+};
+
 struct SpriteSet
 {
     std::vector<Image> views;
@@ -178,20 +479,191 @@ struct ColumnProp
 };
 
 
+// One object that survived culling this frame (built by buildRenderQueue in RenderQueue.h)
+enum class RenderKind
+{
+    PROP,
+    BOX
+};
+
+struct RenderItem
+{
+    RenderKind kind = RenderKind::PROP;
+    int index = 0;          // into props or benches3D
+    float depth = 0.0f;     // camera-space depth of its center; the queue is sorted far to near
+    float nearDepth = 0.0f; // closest camera-space depth, tested against the wall zbuffer
+    int x0 = 0, x1 = 0;     // screen columns it can cover
+    float camX = 0.0f;      // props: camera-space position
+    float camY = 0.0f;
+};
+
+// What was drawn at a pixel, as stored in Engine::idBuffer: the kind in the top 4 bits
+// and an index in the low 12 (artworks/props/benches3D index, or map tile for doors)
+enum class ObjectKind
+{
+    NONE,
+    ARTWORK,
+    PROP,
+    BOX,
+    DOOR
+};
+
+inline Uint16 objectId( ObjectKind kind, int index ) {
+    return Uint16( (int( kind ) << 12) | (index & 0x0FFF) );
+}
+
+inline ObjectKind objectKind( Uint16 id ) {
+    return ObjectKind( id >> 12 );
+}
+
+inline int objectIndex( Uint16 id ) {
+    return id & 0x0FFF;
+}
+
+// Result of casting one wall ray through the tile map
+struct WallHit
+{
+    int tile = 0;              // tile type that was hit, 0 if the ray left the map
+    int side = 0;              // 0 = vertical face (x step), 1 = horizontal face (y step)
+    int mapX = 0, mapY = 0;    // tile coords of the hit
+    float perpWallDist = 0.0f; // distance along the view direction
+    float wallX = 0.0f;        // 0..1 along the face, for texturing
+};
+
+// Per-worker scratch for the strip renderer
+struct StripScratch
+{
+    // Wall span per column, so floor/ceiling don't overwrite walls
+    std::vector<int> clipTop;
+    std::vector<int> clipBot;
+    std::vector<WallHit> hits; // wall ray per column
+    std::vector<Uint32> floorTile; // RENDER_STRIP_W x RENDER_H rows for the column-major target
+    std::vector<int> surfaceFaces; // decorated wall faces drawn this frame, for the surface cache
+};
+
+// Light level per distance for one kind of surface (built by buildLighting in Lighting.h)
+struct LightRamp
+{
+    std::vector<Uint8> levels; // one entry per 1/LIGHT_DIST_SCALE of distance
+
+    int levelAt( float dist ) const {
+        int i = int( dist * LIGHT_DIST_SCALE );
+        return levels[ std::clamp( i, 0, (int)levels.size() - 1 ) ];
+    }
+};
+
+// A texture pre-multiplied by every light level, like a Doom colormap. INDEXED8 textures
+// keep one image, indices and mips shared by all levels, and shade only a palette per level.
+struct LightBanks
+{
+    std::vector<Image> banks; // banks[ LIGHT_LEVELS - 1 ] is the unshaded texture; just that one for INDEXED8
+    std::vector<std::vector<Uint32>> palettes; // INDEXED8: the texture's palette at each level
+
+    const Image &at( int level ) const {
+        return palettes.empty() ? banks[ level ] : banks.front();
+    }
+
+    // Colors to read at( level )'s texels through (see Image::withFetch); nullptr when
+    // the bank itself is shaded
+    const Uint32 *palette( int level ) const {
+        return palettes.empty() ? nullptr : palettes[ level ].data();
+    }
+};
+
+// A wall face baked with its artworks (built by bakeSurface in SurfaceCache.h)
+struct Surface
+{
+    Image image;         // column-major with mips; alpha is how much distance light applies
+    size_t bytes = 0;    // image and mips
+    Uint64 lastUsed = 0; // frame it was last drawn, for LRU eviction
+};
+
+struct SurfaceCache
+{
+    std::unordered_map<int, Surface> faces; // by wall face index (see wallFaceIndex)
+    size_t bytes = 0;
+    Uint64 frame = 0;
+};
+
+// Frame time tracking for dynamic resolution (see DynamicResolution.h)
+struct DynamicResolution
+{
+    int level = 0;             // steps below full size
+    float averageMs = 0.0f;    // smoothed world pass time
+    int cooldown = 0;          // frames before the size may change again
+    std::chrono::steady_clock::time_point passStart;
+    std::chrono::steady_clock::time_point passEnd;
+    std::atomic<int> stripsLeft{ 0 }; // strips of the current pass still rendering
+};
+
+// What a frame shows besides level data, compared between frames (see StaticFrame.h)
+struct FrameState
+{
+    float positionX = 0.0f, positionY = 0.0f;
+    float directionX = 0.0f, directionY = 0.0f;
+    int level = 0;
+    size_t props = 0, boxes = 0;
+    bool showHelp = false, placardOpen = false, journalOpen = false;
+    bool inRangeOfStatue = false, statueChatActive = false;
+    int openArtId = -1;
+};
+
+// The last rendered frame, while the loop may keep it instead of rendering again
+struct StaticFrame
+{
+    FrameState shown;
+    bool valid = false; // false after changes the state doesn't cover (doors, level loads, window events)
+};
+
+// Potentially visible set of every tile, as bit rows of words Uint64s (see Visibility.h)
+struct Visibility
+{
+    int words = 0;
+    std::vector<Uint64> sets; // tile t sees tile v when bit v of row t is set
+};
+
+
 struct Engine
 {
     SDL_Window *window = nullptr;
     SDL_Renderer *renderer = nullptr;
     SDL_Texture *backtexure = nullptr; // streaming texture
-    std::vector<Uint32> backbuffer;
+    std::vector<Uint32> backbuffer; // frame being rendered
+    std::deque<std::vector<Uint32>> presentQueue; // finished frames waiting to be presented
+    std::vector<std::vector<Uint32>> spareFrames; // presented frames, reused as backbuffers
+    std::vector<Uint32> columnFrame; // column-major world target (config::columnMajorTarget)
+    std::vector<Uint32> worldFrame;  // row-major world at renderW x renderH, when scaled down
+    StaticFrame staticFrame;         // what the window shows, for idling while nothing changes
+
+    // World pass size, at most RENDER_W x RENDER_H (see DynamicResolution.h). The UI and
+    // the presented frame stay at full size.
+    int renderW = RENDER_W;
+    int renderH = RENDER_H;
+    DynamicResolution resolution;
+
+    // Where putPix writes: pixel (x, y) is target[ x * targetStepX + y * targetStepY ],
+    // for x < targetW and y < targetH
+    Uint32 *target = nullptr;
+    int targetStepX = 1;
+    int targetStepY = RENDER_W;
+    int targetW = RENDER_W;
+    int targetH = RENDER_H;
+
+    // Object id per pixel of the last world pass, column-major (x * renderH + y), so
+    // picking is one lookup. ids is where the current pass writes, null when disabled.
+    std::vector<Uint16> idBuffer;
+    Uint16 *ids = nullptr;
 
     Map map;
+    Visibility visibility; // from each floor tile, rebuilt by loadLevel and door toggles
     Image wallTex;
     Image floorTex;
     Image ceilTex;
     bool hasFloor = false;
     bool hasCeiling = false;
     std::vector<Artwork> artworks;
+    std::vector<std::vector<ArtworkSpan>> artworkFaces; // per (tile, side), sorted by u0
+    SurfaceCache surfaces; // baked faces of artworkFaces, updated between frames
     std::vector<Image> artImages;
     std::vector<Sprite> sprites;
 
@@ -201,6 +673,9 @@ struct Engine
     float planeY = directionX * FOV_TAN;
     std::vector<float> zbuffer; // SSAO
 
+    WorkerPool workers;
+    std::vector<StripScratch> stripScratch; // one per worker
+
     bool showHelp = true;
     int nearestArt = -1;
     Uint32 lastPlacardTick = 0;
@@ -221,6 +696,10 @@ struct Engine
     std::vector<std::vector<int>> quadBuckets;
 
     std::vector<BoxProp> benches3D;   // NEW: true 3D benches (box + legs)
+    std::vector<BoxFace> boxFaces;    // faces of all benches3D, built once at load
+    std::vector<Image> boxTextures;   // shared by the boxes, by handle
+
+    std::vector<RenderItem> renderQueue; // visible props and boxes this frame, far to near
 
     bool caveMode = false;
     bool hasWallOverlay = false;
@@ -228,6 +707,11 @@ struct Engine
 	float lightFalloff = 2.0f;
 	float caveAmbient = 0.08f;
 
+    // Distance shading, rebuilt by loadLevel
+    LightRamp wallLight, floorLight, ceilLight;
+    LightRamp torchLight; // cave light only, no distance falloff
+    LightBanks wallBanks, doorBanks, floorBanks, ceilBanks;
+
     Image wallOverlay;
     Image floorOverlayCracks, floorOverlayStains, floorOverlayPuddles;
     bool hasFloorCracks = false, hasFloorStains = false, hasFloorPuddles = false;
@@ -260,16 +744,120 @@ struct Engine
     Uint32 statueChatStartTick = 0;   
 };
 
-static bool loadImageOrFallback( const std::string &path, Image &out, Uint32 fillRgb = 0 ) {
-    if (out.loadBMP( path )) return true;
-    // simple 64x64 fallback if missing
-    out.width = 64;
-    out.height = 64;
-    out.pixels.assign( 64 * 64, fillRgb ? fillRgb : rgb( 255, 0, 255 ) );
-    return false;
+// Loads a keyed sprite/artwork image with its alpha and mip chain
+static bool loadImageOrFallback( const std::string &path, Image &out, Uint32 fillRgb = 0, ColorKey key = ColorKey::MAGENTA ) {
+    bool loaded = out.loadBMP( path );
+    if (!loaded)
+    {
+        // simple 64x64 fallback if missing
+        out.fill( 64, 64, fillRgb ? fillRgb : rgb( 255, 0, 255 ) );
+    }
+    out.keyToAlpha( key );
+    out.buildMips();
+    return loaded;
+}
+
+// Loads a billboard prop image: keyed like loadImageOrFallback, then column-major with
+// its opaque runs, since the prop renderer draws it a column at a time
+static bool loadSpriteImage( const std::string &path, Image &out ) {
+    bool loaded = loadImageOrFallback( path, out, rgb( 255, 0, 255 ), ColorKey::NEAR_MAGENTA );
+    out.buildRuns();
+    out.makeColumnMajor();
+    return loaded;
+}
+
+// Storage format per texture file of a level. formats.txt lines are
+// "<file.bmp> <ARGB8888|RGB565|INDEXED8>"; "* <format>" sets the default.
+struct TextureFormats
+{
+    TextureFormat fallback = TextureFormat::ARGB8888;
+    std::unordered_map<std::string, TextureFormat> byFile;
+
+    TextureFormat formatFor( const std::string &file ) const {
+        auto it = byFile.find( file );
+        return it != byFile.end() ? it->second : fallback;
+    }
+};
+
+static bool loadTextureFormats( const std::string &path, TextureFormats &out ) {
+    out = TextureFormats();
+    std::ifstream formatsFileStream( path );
+    if (!formatsFileStream.is_open()) return false; // everything stays ARGB8888
+
+    std::string line; int lineTrack = 0;
+    while (std::getline( formatsFileStream, line ))
+    {
+        ++lineTrack;
+        if (line.empty() || line[ 0 ] == '#') continue;
+
+        std::istringstream ss( line );
+        std::string file, formatName;
+        if (!(ss >> file >> formatName))
+        {
+            std::fprintf( stderr, "Bad format line %d in %s\n", lineTrack, path.c_str() ); continue;
+        }
+        for (auto &c : formatName) c = char( std::toupper( unsigned char( c ) ) );
+
+        TextureFormat format;
+        if (formatName == "ARGB8888") format = TextureFormat::ARGB8888;
+        else if (formatName == "RGB565") format = TextureFormat::RGB565;
+        else if (formatName == "INDEXED8") format = TextureFormat::INDEXED8;
+        else
+        {
+            std::fprintf( stderr, "Unknown texture format %s on line %d in %s\n", formatName.c_str(), lineTrack, path.c_str() ); continue;
+        }
+
+        if (file == "*") out.fallback = format;
+        else out.byFile[ file ] = format;
+    }
+    return true;
+}
+
+// Compresses every loaded texture of the level by file name. Call after all textures
+// have their mips and layout, and before the light banks copy them.
+static void applyTextureFormats( Engine &engineContext, const TextureFormats &formats ) {
+    auto apply = [&]( Image &img ) {
+        if (!img.name.empty()) img.compress( formats.formatFor( img.name ) );
+        };
+
+    for (Image *img : { &engineContext.wallTex, &engineContext.floorTex, &engineContext.ceilTex, &engineContext.doorTexture,
+        &engineContext.wallOverlay })
+    {
+        apply( *img );
+    }
+    for (auto &img : engineContext.artImages) apply( img );
+    for (auto &img : engineContext.propImages) apply( img );
+    for (auto &entry : engineContext.columnSpriteSets)
+    {
+        for (auto &img : entry.second.views) apply( img );
+    }
+    for (auto &img : engineContext.boxTextures) apply( img );
 }
 
 
+// Box side texture handle, loading the file the first time it is asked for
+static int loadBoxTexture( Engine &engineContext, const std::string &path, Uint32 fillRgb ) {
+    const std::string name = fs::path( path ).filename().string();
+    for (int i = 0; i < (int)engineContext.boxTextures.size(); ++i)
+    {
+        if (engineContext.boxTextures[ i ].name == name) return i;
+    }
+
+    Image texture;
+    if (!texture.loadBMP( path ))
+    {
+        // Fallback to a solid color if texture fails
+        texture.fill( 64, 64, fillRgb );
+        texture.name = name;
+    }
+    texture.keyToAlpha( ColorKey::NEAR_BLACK );
+    texture.buildMips();
+    texture.buildRuns();
+    texture.makeColumnMajor();
+    engineContext.boxTextures.push_back( std::move( texture ) );
+    return (int)engineContext.boxTextures.size() - 1;
+}
+
 static bool loadColumns( const std::string &path, Engine &engineContext ) {
     std::ifstream colFileStream( path );
     if (!colFileStream.is_open())
@@ -317,7 +905,7 @@ static bool loadColumns( const std::string &path, Engine &engineContext ) {
             {
                 Image img;
                 std::string fullPath = resolve( bmpFile );
-                if (loadImageOrFallback( fullPath, img, rgb( 255, 0, 255 ) ))
+                if (loadImageOrFallback( fullPath, img, rgb( 255, 0, 255 ), ColorKey::NEAR_BLACK ))
                 {
                     newSet.views.push_back( std::move( img ) );
                 }
@@ -374,15 +962,7 @@ static bool loadColumns( const std::string &path, Engine &engineContext ) {
             box.height = height;
 
             // Load the texture for the column
-            std::string fullPath = resolve( texturePath );
-            if (!box.sideTexure.loadBMP( fullPath ))
-            {
-                // Fallback to a solid color if texture fails
-                box.sideTexure.width = 64;
-                box.sideTexure.height = 64;
-                box.sideTexure.pixels.assign( 64 * 64, rgb( 100, 100, 100 ) );
-            }
-            box.legTexure = box.sideTexure; // Can reuse or load a different one
+            box.sideTexture = loadBoxTexture( engineContext, resolve( texturePath ), rgb( 100, 100, 100 ) );
 
             // Set leg parameters to 0 for a simple pillar
             box.legHalf = 0.0f;
@@ -548,7 +1128,7 @@ static bool loadProps( const std::string &path, std::vector<Prop> &outProps, std
         auto it = textureIndex.find( full );
         if (it != textureIndex.end()) return it->second;
         Image img; 
-        loadImageOrFallback( full, img, rgb( 255, 0, 255 ) );
+        loadSpriteImage( full, img );
         int idx = (int)outPropImages.size();
         outPropImages.push_back( std::move( img ) );
         textureIndex[ full ] = idx;
@@ -672,6 +1252,7 @@ static bool addQuadProp( Engine &engineContext, float centerX, float centerY, fl
         std::fprintf( stderr, "Couldn't load quad texture %s\n", texturePath );
         return false;
     }
+    quad.texture.keyToAlpha( ColorKey::MAGENTA );
     engineContext.quads.push_back( std::move( quad ) );
     return true;
 }
@@ -684,7 +1265,7 @@ void placePlant( Engine &engineContext, const float2 &position, const std::strin
     plant.kind = "PLANT";
     // Load texture once (if not already loaded)
     Image img;
-    loadImageOrFallback( bmp, img, rgb( 255, 0, 255 ) );
+    loadSpriteImage( bmp, img );
     int textureID = (int)engineContext.propImages.size();
     engineContext.propImages.push_back( std::move( img ) );
     plant.textureID = textureID;
@@ -700,7 +1281,7 @@ void placeRope( Engine &engineContext, const float2 &position, const std::string
     rope.kind = "ROPE";
     // Load texture once (if not already loaded)
     Image img;
-    loadImageOrFallback( bmp, img, rgb( 255, 0, 255 ) );
+    loadSpriteImage( bmp, img );
     int textureID = (int)engineContext.propImages.size();
     engineContext.propImages.push_back( std::move( img ) );
     rope.textureID = textureID;
@@ -717,7 +1298,7 @@ void placeStatue( Engine &engineContext, const float2 &position, const std::stri
     statue.kind = "STATUE";
     // Load texture once (if not already loaded)
     Image img;
-    loadImageOrFallback( bmp, img, rgb( 255, 0, 255 ) );
+    loadSpriteImage( bmp, img );
     int textureID = (int)engineContext.propImages.size();
     engineContext.propImages.push_back( std::move( img ) );
     statue.textureID = textureID;
@@ -752,7 +1333,7 @@ void placeVase( Engine &engineContext, const float2 &position, const std::string
 
     // Load texture once (if not already loaded)
     Image img;
-    loadImageOrFallback( bmp + "/" + vase.filename, img, rgb( 255, 0, 255 ) );
+    loadSpriteImage( bmp + "/" + vase.filename, img );
     int texId = (int)engineContext.propImages.size();
     engineContext.propImages.push_back( std::move( img ) );
     vase.textureID = texId;
@@ -771,7 +1352,7 @@ void placeCan( Engine &engineContext, const float2 &position, const std::string
 
     // Load texture once (if not already loaded)
     Image img;
-    loadImageOrFallback( bmp, img, rgb( 255, 0, 255 ) );
+    loadSpriteImage( bmp, img );
     int texId = (int)engineContext.propImages.size();
     engineContext.propImages.push_back( std::move( img ) );
     can.textureID = texId;
@@ -1,7 +1,10 @@
+#pragma once
 #include "Constants.h"
 #include "MapHelpers.h"
+#include "Settings.h"
 #include <cmath>
 #include <vector>
+#include <deque>
 #include <string>
 #include <array>
 #include <fstream>
@@ -9,11 +12,22 @@
 #include <algorithm>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <unordered_map>
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_main.h>   
 #include <filesystem>
 #include <iostream>
+#include <chrono>
+
+// SSE2 is baseline on x64, but MSVC doesn't define __SSE2__, so check its macros too
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAS_SSE2 1
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 enum Levels
 {
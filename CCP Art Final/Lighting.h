@@ -0,0 +1,165 @@
+#pragma once
+#include "GameEngine.h"
+
+// Precomputed distance lighting. Each surface gets a table from distance to one of
+// LIGHT_LEVELS levels, and each wall/door/floor/ceiling texture gets one pre-shaded
+// copy per level (an INDEXED8 texture one shaded palette per level), so the renderers
+// pick a bank instead of calling pow and multiplying every channel. Levels are quantized, so the shading steps slightly with distance.
+
+inline float lightLevelShade( int level ) {
+    return level / float( LIGHT_LEVELS - 1 );
+}
+
+inline int shadeToLightLevel( float shade ) {
+    return std::clamp( int( shade * (LIGHT_LEVELS - 1) + 0.5f ), 0, LIGHT_LEVELS - 1 );
+}
+
+// Torch light of the cave levels (1 elsewhere)
+static float caveLightAt( const Engine &engineContext, float dist ) {
+    if (!engineContext.caveMode) return 1.0f;
+    float R = engineContext.lightRadius;
+    float t = std::clamp( 1.0f - std::pow( dist / std::max( 0.001f, R ), engineContext.lightFalloff ), 0.0f, 1.0f );
+    return std::max( engineContext.caveAmbient, t );
+}
+
+// shade = clamp(1 / (falloff * dist), minShade, 1) * cave light; falloff 0 skips the distance term
+static void buildLightRamp( const Engine &engineContext, LightRamp &ramp, float falloff, float minShade ) {
+    int count = int( LIGHT_DIST_MAX * LIGHT_DIST_SCALE ) + 1;
+    ramp.levels.resize( count );
+    for (int i = 0; i < count; ++i)
+    {
+        float dist = i / float( LIGHT_DIST_SCALE );
+        float shade = 1.0f;
+        if (falloff > 0.0f) shade = std::clamp( 1.0f / (falloff * std::max( dist, 1e-3f )), minShade, 1.0f );
+        shade *= caveLightAt( engineContext, dist );
+        ramp.levels[ i ] = Uint8( shadeToLightLevel( shade ) );
+    }
+}
+
+// Shades an RGB565 or ARGB8888 image and its mips in place
+static void shadeImage( Image &image, int shade88 ) {
+    if (image.format == TextureFormat::RGB565)
+    {
+        for (Uint16 &p : image.pixels565) p = toRGB565( colorMul( fromRGB565( p ), shade88 ) );
+    }
+    else
+    {
+        colorMulSpan( image.pixels.data(), (int)image.pixels.size(), shade88 );
+    }
+    for (auto &mip : image.mips) shadeImage( mip, shade88 );
+}
+
+// Banks copy the texture's mip chain, shaded along with the base level. An INDEXED8
+// texture and its mips share one palette, so its banks are one copy of the indices and
+// that palette shaded per level.
+static void buildLightBanks( const Image &texture, LightBanks &banks ) {
+    if (texture.format == TextureFormat::INDEXED8)
+    {
+        banks.banks.assign( 1, texture );
+        banks.palettes.assign( LIGHT_LEVELS, texture.palette );
+        for (int level = 0; level < LIGHT_LEVELS - 1; ++level)
+        {
+            auto &colors = banks.palettes[ level ];
+            colorMulSpan( colors.data(), (int)colors.size(), toShade88( lightLevelShade( level ) ) );
+        }
+        return;
+    }
+
+    banks.palettes.clear();
+    banks.banks.assign( LIGHT_LEVELS, texture );
+    for (int level = 0; level < LIGHT_LEVELS - 1; ++level)
+    {
+        shadeImage( banks.banks[ level ], toShade88( lightLevelShade( level ) ) );
+    }
+}
+
+// Call once the level's textures and light parameters are set
+static void buildLighting( Engine &engineContext ) {
+    buildLightRamp( engineContext, engineContext.wallLight, 0.4f, 0.15f );
+    buildLightRamp( engineContext, engineContext.floorLight, 0.02f, 0.30f );
+    buildLightRamp( engineContext, engineContext.ceilLight, 0.02f, 0.35f );
+    buildLightRamp( engineContext, engineContext.torchLight, 0.0f, 0.0f );
+
+    buildLightBanks( engineContext.wallTex, engineContext.wallBanks );
+    buildLightBanks( engineContext.doorTexture, engineContext.doorBanks );
+    buildLightBanks( engineContext.floorTex, engineContext.floorBanks );
+    buildLightBanks( engineContext.ceilTex, engineContext.ceilBanks );
+}
+
+// Darkening multiplier from an overlay texel's luminance: dark texels pull the surface
+// down by up to strength, then the result is clamped to [minMul, maxMul]. It never
+// exceeds 1, so the baked maps (255 = 1.0) can hold it.
+inline float overlayMul( Uint32 oc, float strength, float minMul, float maxMul, float gamma = 1.0f ) {
+    float L = std::pow( colorLuma( oc ) / 255.0f, gamma );
+    float m = 1.0f - strength * (1.0f - L);
+    return std::clamp( m, minMul, maxMul );
+}
+
+// Overlay texel for texel (x, y) of a width x height map, tiled by texture fraction
+inline Uint32 overlayAt( const Image &overlay, int x, int y, int width, int height ) {
+    return overlay.sample( int( (long long)x * overlay.width / width ), int( (long long)y * overlay.height / height ) );
+}
+
+inline void resizeGrayTex( Engine::GrayTex &tex, int width, int height ) {
+    tex.width = width;
+    tex.height = height;
+    tex.data.assign( size_t( width ) * height, 255 );
+}
+
+inline void multiplyGrayTex( Engine::GrayTex &tex, int x, int y, float m ) {
+    Uint8 &v = tex.data[ y * tex.width + x ];
+    v = Uint8( std::clamp( v * m + 0.5f, 0.0f, 255.0f ) );
+}
+
+// Folds the active wall and floor overlays into engineContext.wallMul / floorMul so the
+// renderers fetch one byte per pixel. wallMul has the wall texture's resolution; floorMul
+// has the largest floor overlay's. Call after the overlays and wall texture are loaded.
+static void bakeOverlayMuls( Engine &engineContext ) {
+    engineContext.hasWallMul = engineContext.hasWallStains || engineContext.hasWallCracks;
+    engineContext.hasFloorMul = engineContext.hasFloorStains || engineContext.hasFloorCracks || engineContext.hasFloorPuddles;
+
+    if (engineContext.hasWallMul)
+    {
+        Engine::GrayTex &mul = engineContext.wallMul;
+        resizeGrayTex( mul, engineContext.wallTex.width, engineContext.wallTex.height );
+        for (int y = 0; y < mul.height; ++y)
+        {
+            for (int x = 0; x < mul.width; ++x)
+            {
+                // Subtle, broad discoloration
+                if (engineContext.hasWallStains)
+                    multiplyGrayTex( mul, x, y, overlayMul( overlayAt( engineContext.wallOverlayStains, x, y, mul.width, mul.height ), 0.40f, 0.85f, 1.00f, 1.2f ) );
+                // Stronger dark filaments, no color shift
+                if (engineContext.hasWallCracks)
+                    multiplyGrayTex( mul, x, y, overlayMul( overlayAt( engineContext.wallOverlayCracks, x, y, mul.width, mul.height ), 0.90f, 0.55f, 1.00f, 1.6f ) );
+            }
+        }
+        engineContext.hasWallMul = mul.valid();
+    }
+
+    if (engineContext.hasFloorMul)
+    {
+        int width = 0, height = 0;
+        for (const Image *overlay : { &engineContext.floorOverlayStains, &engineContext.floorOverlayCracks, &engineContext.floorOverlayPuddles })
+        {
+            width = std::max( width, overlay->width );
+            height = std::max( height, overlay->height );
+        }
+
+        Engine::GrayTex &mul = engineContext.floorMul;
+        resizeGrayTex( mul, width, height );
+        for (int y = 0; y < mul.height; ++y)
+        {
+            for (int x = 0; x < mul.width; ++x)
+            {
+                if (engineContext.hasFloorStains)
+                    multiplyGrayTex( mul, x, y, overlayMul( overlayAt( engineContext.floorOverlayStains, x, y, width, height ), 0.45f, 0.80f, 1.00f, 1.2f ) );
+                if (engineContext.hasFloorCracks)
+                    multiplyGrayTex( mul, x, y, overlayMul( overlayAt( engineContext.floorOverlayCracks, x, y, width, height ), 0.85f, 0.55f, 1.00f, 1.6f ) );
+                if (engineContext.hasFloorPuddles)
+                    multiplyGrayTex( mul, x, y, overlayMul( overlayAt( engineContext.floorOverlayPuddles, x, y, width, height ), 0.60f, 0.70f, 1.00f, 1.1f ) );
+            }
+        }
+        engineContext.hasFloorMul = mul.valid();
+    }
+}
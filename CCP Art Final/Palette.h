@@ -0,0 +1,138 @@
+#pragma once
+#include "Includes.h"
+
+// Median-cut palettes for 8-bit indexed textures. Colors are binned at 5 bits per
+// channel; boxes of bins are split at the population median of their widest channel
+// until there are maxColors boxes, and each entry is the mean of the colors in its box.
+
+inline int colorBin15( Uint32 c ) {
+    return int( ((c >> 9) & 0x7C00) | ((c >> 6) & 0x03E0) | ((c >> 3) & 0x001F) );
+}
+
+static std::vector<Uint32> buildPalette( const std::vector<Uint32> &colors, int maxColors ) {
+    const int BIN_COUNT = 1 << 15;
+    std::vector<Uint32> count( BIN_COUNT, 0 );
+    std::vector<Uint64> sumR( BIN_COUNT, 0 ), sumG( BIN_COUNT, 0 ), sumB( BIN_COUNT, 0 );
+    for (Uint32 c : colors)
+    {
+        int bin = colorBin15( c );
+        ++count[ bin ];
+        sumR[ bin ] += (c >> 16) & 255;
+        sumG[ bin ] += (c >> 8) & 255;
+        sumB[ bin ] += c & 255;
+    }
+
+    std::vector<int> bins;
+    for (int bin = 0; bin < BIN_COUNT; ++bin)
+    {
+        if (count[ bin ]) bins.push_back( bin );
+    }
+    if (bins.empty()) return {};
+
+    // channel 0 = R, 1 = G, 2 = B, as 5-bit values
+    auto channel = []( int bin, int ch ) {
+        return (bin >> (10 - 5 * ch)) & 31;
+        };
+
+    struct Box { int begin, end; };
+    std::vector<Box> boxes = { { 0, (int)bins.size() } };
+    while ((int)boxes.size() < maxColors)
+    {
+        // Split the box with the most population times extent
+        int best = -1, bestChannel = 0;
+        Uint64 bestScore = 0;
+        for (int i = 0; i < (int)boxes.size(); ++i)
+        {
+            const Box &box = boxes[ i ];
+            if (box.end - box.begin < 2) continue;
+            int lo[ 3 ] = { 31, 31, 31 }, hi[ 3 ] = { 0, 0, 0 };
+            Uint64 population = 0;
+            for (int k = box.begin; k < box.end; ++k)
+            {
+                for (int ch = 0; ch < 3; ++ch)
+                {
+                    lo[ ch ] = std::min( lo[ ch ], channel( bins[ k ], ch ) );
+                    hi[ ch ] = std::max( hi[ ch ], channel( bins[ k ], ch ) );
+                }
+                population += count[ bins[ k ] ];
+            }
+            int widest = 0;
+            for (int ch = 1; ch < 3; ++ch)
+            {
+                if (hi[ ch ] - lo[ ch ] > hi[ widest ] - lo[ widest ]) widest = ch;
+            }
+            Uint64 score = population * Uint64( hi[ widest ] - lo[ widest ] + 1 );
+            if (score > bestScore)
+            {
+                bestScore = score;
+                best = i;
+                bestChannel = widest;
+            }
+        }
+        if (best < 0) break;
+
+        const int begin = boxes[ best ].begin, end = boxes[ best ].end;
+        std::sort( bins.begin() + begin, bins.begin() + end, [&]( int a, int b ) {
+            return channel( a, bestChannel ) < channel( b, bestChannel );
+            } );
+
+        Uint64 population = 0;
+        for (int k = begin; k < end; ++k) population += count[ bins[ k ] ];
+        Uint64 below = 0;
+        int split = begin;
+        while (split < end - 1 && below + count[ bins[ split ] ] <= population / 2) below += count[ bins[ split++ ] ];
+        split = std::max( split, begin + 1 );
+
+        boxes[ best ].end = split;
+        boxes.push_back( { split, end } );
+    }
+
+    std::vector<Uint32> palette;
+    palette.reserve( boxes.size() );
+    for (const Box &box : boxes)
+    {
+        Uint64 n = 0, r = 0, g = 0, b = 0;
+        for (int k = box.begin; k < box.end; ++k)
+        {
+            n += count[ bins[ k ] ];
+            r += sumR[ bins[ k ] ];
+            g += sumG[ bins[ k ] ];
+            b += sumB[ bins[ k ] ];
+        }
+        palette.push_back( 0xFF000000u | Uint32( (r + n / 2) / n ) << 16 | Uint32( (g + n / 2) / n ) << 8 | Uint32( (b + n / 2) / n ) );
+    }
+    return palette;
+}
+
+// Nearest palette entry per color, cached per 15-bit bin. Only the first count entries
+// are candidates, so a trailing clear entry can be left out.
+struct PaletteLookup
+{
+    const std::vector<Uint32> &palette;
+    int count;
+    std::vector<Sint16> cache;
+
+    PaletteLookup( const std::vector<Uint32> &entries, int candidates ) : palette( entries ), count( candidates ), cache( 1 << 15, -1 ) {}
+
+    Uint8 nearest( Uint32 c ) {
+        Sint16 &cached = cache[ colorBin15( c ) ];
+        if (cached >= 0) return Uint8( cached );
+
+        int r = (c >> 16) & 255, g = (c >> 8) & 255, b = c & 255;
+        int best = 0, bestDist = INT_MAX;
+        for (int i = 0; i < count; ++i)
+        {
+            Uint32 p = palette[ i ];
+            int dr = int( (p >> 16) & 255 ) - r, dg = int( (p >> 8) & 255 ) - g, db = int( p & 255 ) - b;
+            // Green weighs most, blue least, roughly as the eye does
+            int dist = 3 * dr * dr + 4 * dg * dg + 2 * db * db;
+            if (dist < bestDist)
+            {
+                bestDist = dist;
+                best = i;
+            }
+        }
+        cached = Sint16( best );
+        return Uint8( best );
+    }
+};
@@ -1,3 +1,4 @@
+#pragma once
 #include "GameEngine.h"
 
 static void artworkMountedCenter( const Engine &engineContext, const Artwork &art, float &centerX, float &centerY) {
@@ -171,3 +172,41 @@ static void attachArtworksToWalls( Engine &engineContext ) {
         }
     }
 }
+
+// Index of a wall face in artworkFaces and the surface cache (-1 off the map)
+static int wallFaceIndex( const Engine &engineContext, int mapX, int mapY, int side ) {
+    if ((unsigned)mapX >= (unsigned)engineContext.map.width || (unsigned)mapY >= (unsigned)engineContext.map.height) return -1;
+    return (mapY * engineContext.map.width + mapX) * 2 + (side ? 1 : 0);
+}
+
+// Buckets the wall-mounted artworks by (tile, side) so a wall column finds the ones on
+// its face without scanning them all. Call after attachArtworksToWalls.
+static void buildArtworkFaceIndex( Engine &engineContext ) {
+    engineContext.artworkFaces.assign( size_t( engineContext.map.width ) * engineContext.map.height * 2, {} );
+    for (int i = 0; i < (int)engineContext.artworks.size(); ++i)
+    {
+        const auto &art = engineContext.artworks[ i ];
+        if (!art.onWall) continue;
+        int face = wallFaceIndex( engineContext, art.wx, art.wy, art.side );
+        if (face < 0) continue;
+
+        ArtworkSpan span;
+        span.artIndex = i;
+        span.u0 = std::clamp( art.uCenter - 0.5f * art.uWidth, 0.0f, 1.0f );
+        span.u1 = std::clamp( art.uCenter + 0.5f * art.uWidth, 0.0f, 1.0f );
+        engineContext.artworkFaces[ face ].push_back( span );
+    }
+    for (auto &face : engineContext.artworkFaces)
+    {
+        std::stable_sort( face.begin(), face.end(), []( const ArtworkSpan &a, const ArtworkSpan &b ) {
+            return a.u0 < b.u0;
+            } );
+    }
+}
+
+// Artworks on one wall face, sorted by u0 (empty when there are none)
+static const std::vector<ArtworkSpan> &artworksOnFace( const Engine &engineContext, int mapX, int mapY, int side ) {
+    static const std::vector<ArtworkSpan> none;
+    int face = wallFaceIndex( engineContext, mapX, mapY, side );
+    return face >= 0 && face < (int)engineContext.artworkFaces.size() ? engineContext.artworkFaces[ face ] : none;
+}
@@ -0,0 +1,202 @@
+#pragma once
+#include "GameEngine.h"
+
+// Wall ray traversal (DDA) through the tile map. castRay() walks one ray; castRayPacket()
+// walks 4 neighbouring columns together in SSE2 lanes, masking each lane out once its ray
+// hits. Both take the same steps with the same float math, so they give identical hits.
+
+// Distance and face coordinate for a ray that stopped at hit.mapX/mapY
+inline void finishWallHit( const Engine &engineContext, float rayDirX, float rayDirY, int stepX, int stepY, WallHit &hit ) {
+    float perpWallDist = (hit.side == 0)
+        ? ((hit.mapX - engineContext.positionX) + (1 - stepX) * 0.5f) / (rayDirX == 0 ? 1e-6f : rayDirX)
+        : ((hit.mapY - engineContext.positionY) + (1 - stepY) * 0.5f) / (rayDirY == 0 ? 1e-6f : rayDirY);
+    hit.perpWallDist = std::max( std::fabs( perpWallDist ), 0.05f );
+
+    float wallX = (hit.side == 0)
+        ? (engineContext.positionY + hit.perpWallDist * rayDirY)
+        : (engineContext.positionX + hit.perpWallDist * rayDirX);
+    hit.wallX = wallX - std::floor( wallX );
+}
+
+inline void castRay( const Engine &engineContext, float rayDirX, float rayDirY, WallHit &hit ) {
+    int mapX = int( engineContext.positionX );
+    int mapY = int( engineContext.positionY );
+
+    float sideDistX, sideDistY;
+    float deltaDistX = (rayDirX == 0) ? 1e30f : std::fabs( 1.0f / rayDirX );
+    float deltaDistY = (rayDirY == 0) ? 1e30f : std::fabs( 1.0f / rayDirY );
+    int stepX = 0, stepY = 0, side = 0;
+
+    if (rayDirX < 0)
+    {
+        stepX = -1; sideDistX = (engineContext.positionX - mapX) * deltaDistX;
+    }
+    else
+    {
+        stepX = 1; sideDistX = (mapX + 1.0f - engineContext.positionX) * deltaDistX;
+    }
+    if (rayDirY < 0)
+    {
+        stepY = -1; sideDistY = (engineContext.positionY - mapY) * deltaDistY;
+    }
+    else
+    {
+        stepY = 1; sideDistY = (mapY + 1.0f - engineContext.positionY) * deltaDistY;
+    }
+
+    hit.tile = 0;
+    while (!hit.tile)
+    {
+        if (sideDistX < sideDistY)
+        {
+            sideDistX += deltaDistX; mapX += stepX; side = 0;
+        }
+        else
+        {
+            sideDistY += deltaDistY; mapY += stepY; side = 1;
+        }
+
+        if (mapX < 0 || mapY < 0 || mapX >= engineContext.map.width || mapY >= engineContext.map.height) return;
+        int tile = engineContext.map.tiles[ mapY * engineContext.map.width + mapX ];
+        if (tile > 0) hit.tile = tile;
+    }
+
+    hit.side = side;
+    hit.mapX = mapX;
+    hit.mapY = mapY;
+    finishWallHit( engineContext, rayDirX, rayDirY, stepX, stepY, hit );
+}
+
+#if HAS_SSE2
+// Four rays at once. Lanes step in lockstep; a lane that hits a tile or leaves the map
+// is masked out and stops changing while the others continue.
+static void castRayPacket( const Engine &engineContext, const float rayDirX[ 4 ], const float rayDirY[ 4 ], WallHit hits[ 4 ] ) {
+    const int startX = int( engineContext.positionX );
+    const int startY = int( engineContext.positionY );
+
+    alignas(16) float sideDistX[ 4 ], sideDistY[ 4 ], deltaDistX[ 4 ], deltaDistY[ 4 ];
+    alignas(16) int stepX[ 4 ], stepY[ 4 ];
+    for (int lane = 0; lane < 4; ++lane)
+    {
+        deltaDistX[ lane ] = (rayDirX[ lane ] == 0) ? 1e30f : std::fabs( 1.0f / rayDirX[ lane ] );
+        deltaDistY[ lane ] = (rayDirY[ lane ] == 0) ? 1e30f : std::fabs( 1.0f / rayDirY[ lane ] );
+        if (rayDirX[ lane ] < 0)
+        {
+            stepX[ lane ] = -1; sideDistX[ lane ] = (engineContext.positionX - startX) * deltaDistX[ lane ];
+        }
+        else
+        {
+            stepX[ lane ] = 1; sideDistX[ lane ] = (startX + 1.0f - engineContext.positionX) * deltaDistX[ lane ];
+        }
+        if (rayDirY[ lane ] < 0)
+        {
+            stepY[ lane ] = -1; sideDistY[ lane ] = (engineContext.positionY - startY) * deltaDistY[ lane ];
+        }
+        else
+        {
+            stepY[ lane ] = 1; sideDistY[ lane ] = (startY + 1.0f - engineContext.positionY) * deltaDistY[ lane ];
+        }
+    }
+
+    __m128 sideX = _mm_load_ps( sideDistX );
+    __m128 sideY = _mm_load_ps( sideDistY );
+    const __m128 deltaX = _mm_load_ps( deltaDistX );
+    const __m128 deltaY = _mm_load_ps( deltaDistY );
+    const __m128i stepXs = _mm_load_si128( (const __m128i *)stepX );
+    const __m128i stepYs = _mm_load_si128( (const __m128i *)stepY );
+    __m128i mapX = _mm_set1_epi32( startX );
+    __m128i mapY = _mm_set1_epi32( startY );
+    __m128i side = _mm_setzero_si128();
+
+    const __m128i laneBits = _mm_setr_epi32( 1, 2, 4, 8 );
+    const __m128i mapW = _mm_set1_epi32( engineContext.map.width );
+    const __m128i mapH = _mm_set1_epi32( engineContext.map.height );
+    const int *tiles = engineContext.map.tiles.data();
+    const int width = engineContext.map.width;
+
+    __m128i active = _mm_set1_epi32( -1 );
+    alignas(16) int tileOut[ 4 ] = { 0, 0, 0, 0 };
+    int activeBits = 0xF;
+
+    while (activeBits)
+    {
+        // Per lane: step X where sideDistX < sideDistY, otherwise step Y
+        __m128i takeX = _mm_and_si128( _mm_castps_si128( _mm_cmplt_ps( sideX, sideY ) ), active );
+        __m128i takeY = _mm_andnot_si128( takeX, active );
+
+        sideX = _mm_add_ps( sideX, _mm_and_ps( deltaX, _mm_castsi128_ps( takeX ) ) );
+        sideY = _mm_add_ps( sideY, _mm_and_ps( deltaY, _mm_castsi128_ps( takeY ) ) );
+        mapX = _mm_add_epi32( mapX, _mm_and_si128( stepXs, takeX ) );
+        mapY = _mm_add_epi32( mapY, _mm_and_si128( stepYs, takeY ) );
+        // side = 0 for X steps, 1 for Y steps, unchanged for finished lanes
+        side = _mm_or_si128( _mm_andnot_si128( active, side ), _mm_and_si128( takeY, _mm_set1_epi32( 1 ) ) );
+
+        // Lanes that walked off the map finish without a hit
+        __m128i outside = _mm_or_si128(
+            _mm_or_si128( _mm_cmpgt_epi32( mapX, _mm_sub_epi32( mapW, _mm_set1_epi32( 1 ) ) ), _mm_cmplt_epi32( mapX, _mm_setzero_si128() ) ),
+            _mm_or_si128( _mm_cmpgt_epi32( mapY, _mm_sub_epi32( mapH, _mm_set1_epi32( 1 ) ) ), _mm_cmplt_epi32( mapY, _mm_setzero_si128() ) ) );
+        active = _mm_andnot_si128( outside, active );
+
+        // Tile fetch for the lanes still walking
+        alignas(16) int lanesX[ 4 ], lanesY[ 4 ];
+        _mm_store_si128( (__m128i *)lanesX, mapX );
+        _mm_store_si128( (__m128i *)lanesY, mapY );
+        int walking = _mm_movemask_ps( _mm_castsi128_ps( active ) );
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            if (!(walking & (1 << lane))) continue;
+            int tile = tiles[ lanesY[ lane ] * width + lanesX[ lane ] ];
+            if (tile > 0)
+            {
+                tileOut[ lane ] = tile;
+                walking &= ~(1 << lane);
+            }
+        }
+        active = _mm_cmpeq_epi32( _mm_and_si128( _mm_set1_epi32( walking ), laneBits ), laneBits );
+        activeBits = walking;
+    }
+
+    alignas(16) int sides[ 4 ], hitX[ 4 ], hitY[ 4 ];
+    _mm_store_si128( (__m128i *)sides, side );
+    _mm_store_si128( (__m128i *)hitX, mapX );
+    _mm_store_si128( (__m128i *)hitY, mapY );
+    for (int lane = 0; lane < 4; ++lane)
+    {
+        WallHit &hit = hits[ lane ];
+        hit.tile = tileOut[ lane ];
+        if (!hit.tile) continue;
+        hit.side = sides[ lane ];
+        hit.mapX = hitX[ lane ];
+        hit.mapY = hitY[ lane ];
+        finishWallHit( engineContext, rayDirX[ lane ], rayDirY[ lane ], stepX[ lane ], stepY[ lane ], hit );
+    }
+}
+#endif
+
+// Casts the wall ray of every column in [xBegin, xEnd) into hits[x]
+static void castColumns( const Engine &engineContext, int xBegin, int xEnd, WallHit *hits ) {
+    auto rayFor = [&]( int x, float &rayDirX, float &rayDirY ) {
+        float camX = 2.0f * x / float( engineContext.renderW ) - 1.0f;
+        rayDirX = engineContext.directionX + engineContext.planeX * camX;
+        rayDirY = engineContext.directionY + engineContext.planeY * camX;
+        };
+
+    int x = xBegin;
+#if HAS_SSE2
+    if (config::packetRays)
+    {
+        for (; x + 4 <= xEnd; x += 4)
+        {
+            float rayDirX[ 4 ], rayDirY[ 4 ];
+            for (int lane = 0; lane < 4; ++lane) rayFor( x + lane, rayDirX[ lane ], rayDirY[ lane ] );
+            castRayPacket( engineContext, rayDirX, rayDirY, hits + x );
+        }
+    }
+#endif
+    for (; x < xEnd; ++x)
+    {
+        float rayDirX, rayDirY;
+        rayFor( x, rayDirX, rayDirY );
+        castRay( engineContext, rayDirX, rayDirY, hits[ x ] );
+    }
+}
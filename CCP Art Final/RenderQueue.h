@@ -0,0 +1,112 @@
+#pragma once
+#include "GameEngine.h"
+#include "RendererHelpers.h"
+#include "Visibility.h"
+
+// Per-frame list of the props and boxes to draw. It is built once before the world pass.
+// Objects outside the camera tile's visible set, behind the camera or off screen are
+// dropped; the rest get their screen column
+// range and depths and are sorted far to near, so every strip draws each object once in
+// painter's order. Strips also skip objects that walls cover in all of their columns.
+
+static void buildRenderQueue( Engine &engineContext ) {
+    auto &queue = engineContext.renderQueue;
+    queue.clear();
+    const int renderW = engineContext.renderW, renderH = engineContext.renderH;
+
+    const float invDet = 1.0f / (engineContext.planeX * engineContext.directionY - engineContext.directionX * engineContext.planeY);
+    auto toCamera = [&]( float wx, float wy, float &camX, float &camY ) {
+        float dx = wx - engineContext.positionX, dy = wy - engineContext.positionY;
+        camX = invDet * (engineContext.directionY * dx - engineContext.directionX * dy);
+        camY = invDet * (-engineContext.planeY * dx + engineContext.planeX * dy);
+        };
+    auto onScreen = [&]( const RenderItem &item ) {
+        return item.x1 >= 0 && item.x0 < renderW && item.x0 <= item.x1;
+        };
+    const Uint64 *visible = visibleFrom( engineContext, engineContext.positionX, engineContext.positionY );
+
+    for (int i = 0; i < (int)engineContext.props.size(); ++i)
+    {
+        const Prop &prop = engineContext.props[ i ];
+        // Billboards turn to the camera, so they can reach half their width either way
+        const float reach = 0.5f * std::fabs( prop.scale );
+        if (!anyTileVisible( engineContext, visible, prop.x - reach, prop.y - reach, prop.x + reach, prop.y + reach )) continue;
+
+        RenderItem item;
+        item.kind = RenderKind::PROP;
+        item.index = i;
+        toCamera( prop.x, prop.y, item.camX, item.camY );
+        if (item.camY <= 0) continue;
+
+        // Same footprint as the billboard renderer
+        int spriteScreenX = int( (renderW / 2) * (1 + item.camX / item.camY) );
+        int spriteW = std::max( 1, int( std::fabs( (renderH / item.camY) * prop.scale ) ) );
+        item.x0 = -spriteW / 2 + spriteScreenX;
+        item.x1 = spriteW / 2 + spriteScreenX - 1;
+        item.depth = item.nearDepth = item.camY;
+        if (onScreen( item )) queue.push_back( item );
+    }
+
+    // Boxes cover their footprint rectangle (legs are inset within it)
+    const float NEAR_Z = 0.05f; // near plane of draw_vertical_face
+    for (int i = 0; i < (int)engineContext.benches3D.size(); ++i)
+    {
+        const BoxProp &box = engineContext.benches3D[ i ];
+        float corners[ 8 ];
+        box_corners( box, corners[ 0 ], corners[ 1 ], corners[ 2 ], corners[ 3 ], corners[ 4 ], corners[ 5 ], corners[ 6 ], corners[ 7 ] );
+        const float minX = std::min( { corners[ 0 ], corners[ 2 ], corners[ 4 ], corners[ 6 ] } );
+        const float maxX = std::max( { corners[ 0 ], corners[ 2 ], corners[ 4 ], corners[ 6 ] } );
+        const float minY = std::min( { corners[ 1 ], corners[ 3 ], corners[ 5 ], corners[ 7 ] } );
+        const float maxY = std::max( { corners[ 1 ], corners[ 3 ], corners[ 5 ], corners[ 7 ] } );
+        if (!anyTileVisible( engineContext, visible, minX, minY, maxX, maxY )) continue;
+
+        RenderItem item;
+        item.kind = RenderKind::BOX;
+        item.index = i;
+        item.x0 = renderW;
+        item.x1 = -1;
+        item.nearDepth = 1e9f;
+        float farDepth = 0.0f;
+        bool clipped = false;
+        for (int c = 0; c < 4; ++c)
+        {
+            float camX, camY;
+            toCamera( corners[ 2 * c ], corners[ 2 * c + 1 ], camX, camY );
+            farDepth = std::max( farDepth, camY );
+            if (camY <= NEAR_Z)
+            {
+                clipped = true;
+                continue;
+            }
+            int sx = int( (renderW * 0.5f) * (1.0f + camX / camY) );
+            item.x0 = std::min( item.x0, sx );
+            item.x1 = std::max( item.x1, sx );
+            item.nearDepth = std::min( item.nearDepth, camY );
+        }
+        if (farDepth <= NEAR_Z) continue; // all behind the camera
+
+        // Crossing the near plane: the clipped edge can reach either screen side
+        if (clipped)
+        {
+            item.x0 = 0;
+            item.x1 = renderW - 1;
+            item.nearDepth = NEAR_Z;
+        }
+        float camX;
+        toCamera( box.centerX, box.centerY, camX, item.depth );
+        if (onScreen( item )) queue.push_back( item );
+    }
+
+    std::stable_sort( queue.begin(), queue.end(), []( const RenderItem &a, const RenderItem &b ) {
+        return a.depth > b.depth;
+        } );
+}
+
+// True when a wall is nearer than the object in every column [cx0, cx1] (zbuffer filled)
+static bool hiddenBehindWalls( const Engine &engineContext, const RenderItem &item, int cx0, int cx1 ) {
+    for (int x = cx0; x <= cx1; ++x)
+    {
+        if (item.nearDepth < engineContext.zbuffer[ x ]) return false;
+    }
+    return true;
+}
@@ -1,7 +1,34 @@
+#pragma once
 #include "GameEngine.h"
+#include "Visibility.h"
+
+// Pixel (x, y) of the current render target, no bounds check
+static Uint32 &targetPixel( Engine &engineContext, int x, int y ) {
+    return engineContext.target[ x * engineContext.targetStepX + y * engineContext.targetStepY ];
+}
 
 static void putPix( Engine &engineContext, int x, int y, Uint32 c ) {
-    if ((unsigned)x < (unsigned)RENDER_W && (unsigned)y < (unsigned)RENDER_H) engineContext.backbuffer[ y * RENDER_W + x ] = c;
+    if ((unsigned)x < (unsigned)engineContext.targetW && (unsigned)y < (unsigned)engineContext.targetH) targetPixel( engineContext, x, y ) = c;
+}
+
+// Premultiplied color covering alpha / 255 of the pixel: 255 writes, 0 leaves it alone
+static void blendPix( Engine &engineContext, int x, int y, Uint32 c, int alpha ) {
+    if (alpha == 0 || (unsigned)x >= (unsigned)engineContext.targetW || (unsigned)y >= (unsigned)engineContext.targetH) return;
+    Uint32 &dst = targetPixel( engineContext, x, y );
+    dst = colorBlendOver( dst, c, alpha );
+}
+
+// Object id of pixel (x, y), when the id buffer is on
+static void putId( Engine &engineContext, int x, int y, Uint16 id ) {
+    if (engineContext.ids && (unsigned)x < (unsigned)engineContext.renderW && (unsigned)y < (unsigned)engineContext.renderH) engineContext.ids[ x * engineContext.renderH + y ] = id;
+}
+
+// Object id of rows y0..y1 in column x
+static void putIdSpan( Engine &engineContext, int x, int y0, int y1, Uint16 id ) {
+    if (!engineContext.ids || (unsigned)x >= (unsigned)engineContext.renderW) return;
+    y0 = std::max( y0, 0 );
+    y1 = std::min( y1, engineContext.renderH - 1 );
+    if (y0 <= y1) std::fill( engineContext.ids + x * engineContext.renderH + y0, engineContext.ids + x * engineContext.renderH + y1 + 1, id );
 }
 
 static void clear( Engine &engineContext, Uint32 top, Uint32 bottom ) {
@@ -12,104 +39,67 @@ static void clear( Engine &engineContext, Uint32 top, Uint32 bottom ) {
         std::fill_n( &engineContext.backbuffer[ y * RENDER_W ], RENDER_W, choice );
     }
 }
-static void drawTexturedColumn( Engine &engineContext, const Image &texture, int x, int drawStart, int drawEnd, float perpDist, float wallX ) {
+static void drawTexturedColumn( Engine &engineContext, const LightBanks &banks, int x, int drawStart, int drawEnd, float perpDist, float wallX ) {
+    const int lineH = std::max( 1, int( engineContext.renderH / std::max( perpDist, 1e-3f ) ) );
+
+    // Distance shade is the same for the whole column, so pick its pre-shaded bank,
+    // then the mip level that maps about one texel to each row
+    const int level = engineContext.wallLight.levelAt( perpDist );
+    const Image &bank = banks.at( level );
+    const Uint32 *colors = banks.palette( level );
+    const Image &texture = bank.levelFor( bank.height / float( lineH ) );
     int textureW = texture.width;
     int textureH = texture.height;
+    if (textureW <= 0 || textureH <= 0) return;
     int textureX = int( wallX * float( textureW ) );
     textureX = std::clamp( textureX, 0, textureW - 1 );
 
-    const int lineH = int( RENDER_H / std::max( perpDist, 1e-3f ) );
+    const int wallTopY = -lineH / 2 + engineContext.renderH / 2;
 
-    const int wallTopY = -lineH / 2 + RENDER_H / 2;
+    const Engine::GrayTex *wallMul = engineContext.hasWallMul ? &engineContext.wallMul : nullptr;
+    const int mulX = wallMul ? textureX * wallMul->width / textureW : 0;
 
-    
+    // Column-major textures give one contiguous run of texels for the whole column
+    const size_t column = texture.columnStart( textureX );
 
-    for (int y = drawStart; y <= drawEnd; ++y)
-    {
-   
-        int y_relative = y - wallTopY;
-        int textureY = int( (y_relative * (float)textureH) / (float)std::max( 1, lineH ) );
-        textureY = std::clamp( textureY, 0, textureH - 1 ); // Clamp to be safe
+    // Texture v in 16.16, stepped once per screen row
+    const Sint64 vStep = (Sint64( textureH ) << 16) / lineH;
+    Sint64 v = Sint64( drawStart - wallTopY ) * vStep;
 
-     
-        Uint32 color = texture.sample( textureX, textureY );
-        float mul = 1.0f;
-
-        // Use texture-space tiling so overlays repeat seamlessly regardless of texture size
-        if (engineContext.hasWallStains)
-        {
-            int ow = engineContext.wallOverlayStains.width, oh = engineContext.wallOverlayStains.height;
-            if (ow > 0 && oh > 0)
-            {
-                int ox = (int)((textureX / float( textureW )) * ow) % ow;
-                int oy = (int)((textureY / float( textureH )) * oh) % oh;
-                if (ox < 0) ox += ow; if (oy < 0) oy += oh;
-                Uint32 oc = engineContext.wallOverlayStains.sample( ox, oy );
-                // Subtle, broad discoloration
-                // strength, min..max, gamma tuned to keep color natural
-                float m = 1.0f - 0.40f * (1.0f - std::pow(
-                    std::clamp( (0.299f * ((oc >> 16) & 255) + 0.587f * ((oc >> 8) & 255) + 0.114f * (oc & 255)) / 255.0f, 0.0f, 1.0f ), 1.2f ));
-                mul *= std::clamp( m, 0.85f, 1.03f );
-            }
-        }
-        if (engineContext.hasWallCracks)
-        {
-            int ow = engineContext.wallOverlayCracks.width, oh = engineContext.wallOverlayCracks.height;
-            if (ow > 0 && oh > 0)
-            {
-                int ox = (int)((textureX / float( textureW )) * ow) % ow;
-                int oy = (int)((textureY / float( textureH )) * oh) % oh;
-                if (ox < 0) ox += ow; if (oy < 0) oy += oh;
-                Uint32 oc = engineContext.wallOverlayCracks.sample( ox, oy );
-                // Stronger dark filaments, no color shift
-                float L = (0.299f * ((oc >> 16) & 255) + 0.587f * ((oc >> 8) & 255) + 0.114f * (oc & 255)) / 255.0f;
-                float m = 1.0f - 0.90f * (1.0f - std::pow( std::clamp( L, 0.0f, 1.0f ), 1.6f ));
-                mul *= std::clamp( m, 0.55f, 1.00f );
-            }
-        }
+    // Consecutive rows are adjacent in a column-major target
+    Uint32 *out = &targetPixel( engineContext, x, drawStart );
+    const int outStep = engineContext.targetStepY;
 
-        // Apply brightness multiplier 
+    texture.withFetch( [&]( auto fetch ) {
+        for (int y = drawStart; y <= drawEnd; ++y, v += vStep, out += outStep)
         {
-            float rf = float( (color >> 16) & 255 ) * mul;
-            float gf = float( (color >> 8) & 255 ) * mul;
-            float bf = float( color & 255 ) * mul;
-            color = rgb(
-                Uint8( std::clamp( rf, 0.0f, 255.0f ) ),
-                Uint8( std::clamp( gf, 0.0f, 255.0f ) ),
-                Uint8( std::clamp( bf, 0.0f, 255.0f ) )
-            );
-        }
+            int textureY = std::min( int( v >> 16 ), textureH - 1 );
 
+            Uint32 color = texture.columnMajor ? fetch( column + textureY ) : texture.sample( textureX, textureY, colors );
 
-        if (engineContext.caveMode && engineContext.hasWallOverlay)
-        {
-            int ox = textureX % engineContext.wallOverlay.width;
-            int oy = textureY % engineContext.wallOverlay.height;
-            Uint32 o = engineContext.wallOverlay.sample( ox, oy );
-            float mr = (((o >> 16) & 255) / 255.0f) * 0.20f + 0.85f;
-            float mg = (((o >> 8) & 255) / 255.0f) * 0.20f + 0.85f;
-            float mb = ((o & 255) / 255.0f) * 0.20f + 0.85f;
-            Uint8 r = Uint8( ((color >> 16) & 255) * mr );
-            Uint8 g = Uint8( ((color >> 8) & 255) * mg );
-            Uint8 b = Uint8( (color & 255) * mb );
-            color = rgb( r, g, b );
-        }
+            // Baked stains/cracks multiplier, tiled by texture fraction
+            if (wallMul)
+            {
+                int my = textureY * wallMul->height / textureH;
+                color = colorMul( color, byteToMul88( wallMul->data[ my * wallMul->width + mulX ] ) );
+            }
 
 
-        float shade = std::clamp( 1.0f / (0.4f * perpDist), 0.15f, 1.0f );
+            if (engineContext.caveMode && engineContext.hasWallOverlay)
+            {
+                int ox = textureX % engineContext.wallOverlay.width;
+                int oy = textureY % engineContext.wallOverlay.height;
+                Uint32 o = engineContext.wallOverlay.sample( ox, oy );
+                // 0.85 + 0.20 * channel / 255 in 8.8
+                int mr = 218 + ((((o >> 16) & 255) * 51) >> 8);
+                int mg = 218 + ((((o >> 8) & 255) * 51) >> 8);
+                int mb = 218 + (((o & 255) * 51) >> 8);
+                color = colorMulRGB( color, mr, mg, mb );
+            }
 
-        if (engineContext.caveMode)
-        {
-            float R = engineContext.lightRadius;
-            float t = std::clamp( 1.0f - std::pow( perpDist / std::max( 0.001f, R ), engineContext.lightFalloff ), 0.0f, 1.0f );
-            float l = std::max( engineContext.caveAmbient, t );
-            shade *= l;
+            *out = color;
         }
-
-        Uint8 r = (color >> 16) & 255, g = (color >> 8) & 255, box = color & 255;
-        r = Uint8( r * shade ); g = Uint8( g * shade ); box = Uint8( box * shade );
-        putPix( engineContext, x, y, rgb( r, g, box ) );
-    }
+        }, colors );
 }
 
 
@@ -578,7 +568,9 @@ static bool toggleDoorAhead( Engine &engineContext) {
     int &cell = engineContext.map.tiles[ ty * engineContext.map.width + tx ];
     if (cell == 2)
     {
-        cell = 0; return true;
+        cell = 0;
+        updateVisibilityForDoor( engineContext, tx, ty );
+        return true;
     }      // open (becomes empty)
     if (cell == 0)
     {                               
@@ -597,7 +589,9 @@ static bool toggleDoorAhead( Engine &engineContext) {
         }
         if (canClose)
         {
-            cell = 2; return true;
+            cell = 2;
+            updateVisibilityForDoor( engineContext, tx, ty );
+            return true;
         }
     }
     return false;
@@ -631,96 +625,65 @@ inline bool ray_segment_intersect( float px, float py,
 }
 
 
-inline bool is_key( Uint32 c ) {
-    return (((c >> 16) & 255) == 255 && ((c >> 8) & 255) == 0 && (c & 255) == 255);
-}
-inline float byte_to_f( Uint32 v ) {
-    return float( v ) / 255.0f;
-}
-inline Uint8  f_to_byte( float f ) {
-    return Uint8( std::clamp( f, 0.0f, 1.0f ) * 255.0f + 0.5f );
-}
-
-inline bool isNearMagenta( Uint32 color, int tol = 12 ) {
-    Uint8 r = (color >> 16) & 255;
-    Uint8 g = (color >> 8) & 255;
-    Uint8 box = color & 255;
-    return (abs( int( r ) - 255 ) <= tol) && (g <= tol) && (abs( int( box ) - 255 ) <= tol);
-}
-
-inline bool boolIsNearBlack( Uint32 color, int tol = 12 ) {
-    Uint8 r = (color >> 16) & 255;
-    Uint8 g = (color >> 8) & 255;
-    Uint8 box = color & 255;
-	return (r <= tol) && (g <= tol) && (box <= tol);
-}
-
 // Sample using normalized UV in [0,1]. If you pass values outside, they clamp.
-// Again thanks stack overflow
-inline Uint32 sample_bilinear_uv_keyed( const Image &texture, float u, float v ) {
+// Bilinear on premultiplied texels with 8-bit weights, so clear neighbours fade the
+// edge out (alpha comes back partial) instead of bleeding their color in.
+inline Uint32 sample_bilinear_uv( const Image &texture, float u, float v ) {
     if (texture.width == 0 || texture.height == 0) return 0;
 
     // Clamp UVs (change to wrap if you prefer tiling)
     u = std::clamp( u, 0.0f, 1.0f );
     v = std::clamp( v, 0.0f, 1.0f );
 
-    float fx = u * (texture.width - 1);
-    float fy = v * (texture.height - 1);
+    // Texel position in 24.8 fixed point
+    int fx = int( u * (texture.width - 1) * 256.0f );
+    int fy = int( v * (texture.height - 1) * 256.0f );
 
-    int x0 = int( fx ), y0 = int( fy );
+    int x0 = fx >> 8, y0 = fy >> 8;
     int x1 = std::min( x0 + 1, texture.width - 1 );
     int y1 = std::min( y0 + 1, texture.height - 1 );
-    float tx = fx - x0, ty = fy - y0;
+    int tx = fx & 255, ty = fy & 255;
 
     Uint32 c00 = texture.sample( x0, y0 );
     Uint32 c10 = texture.sample( x1, y0 );
     Uint32 c01 = texture.sample( x0, y1 );
     Uint32 c11 = texture.sample( x1, y1 );
 
-    // Treat magenta as alpha=0, everything else alpha=1
-    float a00 = is_key( c00 ) ? 0.0f : 1.0f;
-    float a10 = is_key( c10 ) ? 0.0f : 1.0f;
-    float a01 = is_key( c01 ) ? 0.0f : 1.0f;
-    float a11 = is_key( c11 ) ? 0.0f : 1.0f;
-
-    auto comp = [&]( int shift )->Uint8 {
-        float v00 = byte_to_f( (c00 >> shift) & 255 ) * a00;
-        float v10 = byte_to_f( (c10 >> shift) & 255 ) * a10;
-        float v01 = byte_to_f( (c01 >> shift) & 255 ) * a01;
-        float v11 = byte_to_f( (c11 >> shift) & 255 ) * a11;
-
-        // bilinear on premultiplied channels
-        float v0 = v00 * (1.0f - tx) + v10 * tx;
-        float v1 = v01 * (1.0f - tx) + v11 * tx;
-        float vp = v0 * (1.0f - ty) + v1 * ty;
-
-        // bilinear on alpha, then unpremultiply (avoid division by tiny)
-        float a0 = a00 * (1.0f - tx) + a10 * tx;
-        float a1 = a01 * (1.0f - tx) + a11 * tx;
-        float ap = a0 * (1.0f - ty) + a1 * ty;
-
-        float out = (ap > 1e-5f) ? (vp / ap) : 0.0f;
-        return f_to_byte( out );
-        };
-
-    // Output stays opaque here; caller can still treat key as transparent if desired.
-    Uint8 r = comp( 16 ), g = comp( 8 ), box = comp( 0 );
-
-    // If blended alpha is ~0, return the key color so your existing checks skip it.
-    float a0 = a00 * (1.0f - tx) + a10 * tx;
-    float a1 = a01 * (1.0f - tx) + a11 * tx;
-    float ap = a0 * (1.0f - ty) + a1 * ty;
-    if (ap <= 1e-5f) return rgb( 255, 0, 255 );
-
-    return rgb( r, g, box );
+#if HAS_SSE2
+    // 16-bit lanes: c00 | c10 on top, c01 | c11 below; lerp rows, then the two halves
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i half = _mm_set1_epi16( 128 );
+    __m128i top = _mm_unpacklo_epi8( _mm_setr_epi32( int( c00 ), int( c10 ), 0, 0 ), zero );
+    __m128i bottom = _mm_unpacklo_epi8( _mm_setr_epi32( int( c01 ), int( c11 ), 0, 0 ), zero );
+    __m128i rows = _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16(
+        _mm_mullo_epi16( top, _mm_set1_epi16( short( 256 - ty ) ) ),
+        _mm_mullo_epi16( bottom, _mm_set1_epi16( short( ty ) ) ) ), half ), 8 );
+    __m128i blended = _mm_srli_epi16( _mm_add_epi16( _mm_add_epi16(
+        _mm_mullo_epi16( rows, _mm_set1_epi16( short( 256 - tx ) ) ),
+        _mm_mullo_epi16( _mm_srli_si128( rows, 8 ), _mm_set1_epi16( short( tx ) ) ) ), half ), 8 );
+    return Uint32( _mm_cvtsi128_si32( _mm_packus_epi16( blended, zero ) ) );
+#else
+    Uint32 out = 0;
+    for (int shift = 0; shift < 32; shift += 8)
+    {
+        Uint32 row0 = ((((c00 >> shift) & 255) * (256 - ty) + ((c01 >> shift) & 255) * ty) + 128) >> 8;
+        Uint32 row1 = ((((c10 >> shift) & 255) * (256 - ty) + ((c11 >> shift) & 255) * ty) + 128) >> 8;
+        out |= ((row0 * (256 - tx) + row1 * tx + 128) >> 8) << shift;
+    }
+    return out;
+#endif
 }
 
 
-inline void draw_vertical_face( Engine &engineContext, float ax, float ay, float bx, float by, float height,   const Image &texture ) {
+// Only columns in [stripBegin, stripEnd) are written, so strips can be rendered in parallel
+// Pixels at least half covered get object id (0 writes none)
+// 1/z and u/z are linear in screen x, so both step per column and each column costs one
+// divide; texture v steps in 16.16 per row over the covered runs of the texel column only
+inline void draw_vertical_face( Engine &engineContext, float ax, float ay, float bx, float by, float height, const Image &texture, int stripBegin, int stripEnd, Uint16 id = 0 ) {
     // Transform endpoints to camera space
+    const float invDet = 1.0f / (engineContext.planeX * engineContext.directionY - engineContext.directionX * engineContext.planeY);
     auto to_cam = [&]( float wx, float wy ) {
         float dx = wx - engineContext.positionX, dy = wy - engineContext.positionY;
-        float invDet = 1.0f / (engineContext.planeX * engineContext.directionY - engineContext.directionX * engineContext.planeY);
         float centerX = invDet * (engineContext.directionY * dx - engineContext.directionX * dy);  // right (+) left (-)
         float centerY = invDet * (-engineContext.planeY * dx + engineContext.planeX * dy);  // forward (+)
         return std::array<float, 2>{centerX, centerY};
@@ -735,114 +698,106 @@ inline void draw_vertical_face( Engine &engineContext, float ax, float ay, float
     // If both behind camera, drop
     if (A[ 1 ] <= NEAR_Z && B[ 1 ] <= NEAR_Z) return;
 
-    auto lerp = []( float a, float box, float t ) { return a + (box - a) * t; };
+    auto lerp = []( float a, float b, float t ) { return a + (b - a) * t; };
+
+    // Texture u along the segment: 0 at A, 1 at B, kept for clipped endpoints
+    float uA = 0.0f, uB = 1.0f;
 
     // If one endpoint is behind, clip it to near
-    auto clip_to_near = [&]( std::array<float, 2> &P, const std::array<float, 2> &Q ) {
+    auto clip_to_near = [&]( std::array<float, 2> &P, float &uP, const std::array<float, 2> &Q, float uQ ) {
         // Find t where centerY == NEAR_Z between P (behind) and Q (in front)
         float t = (NEAR_Z - P[ 1 ]) / (Q[ 1 ] - P[ 1 ]);
         P[ 0 ] = lerp( P[ 0 ], Q[ 0 ], t );
         P[ 1 ] = NEAR_Z;
+        uP = lerp( uP, uQ, t );
         };
 
-    std::array<float, 2> A0 = A, B0 = B; // keep originals for u
     float segLen = std::sqrt( (bx - ax) * (bx - ax) + (by - ay) * (by - ay) );
     if (segLen < 1e-6f) return;
 
-    if (A[ 1 ] < NEAR_Z && B[ 1 ] > NEAR_Z) clip_to_near( A, B );
-    else if (B[ 1 ] < NEAR_Z && A[ 1 ] > NEAR_Z) clip_to_near( B, A );
+    if (A[ 1 ] < NEAR_Z && B[ 1 ] > NEAR_Z) clip_to_near( A, uA, B, uB );
+    else if (B[ 1 ] < NEAR_Z && A[ 1 ] > NEAR_Z) clip_to_near( B, uB, A, uA );
 
     // Project to screen X
     auto to_screen_x = [&]( const std::array<float, 2> &P ) {
-        return int( (RENDER_W * 0.5f) * (1.0f + P[ 0 ] / P[ 1 ]) );
+        return int( (engineContext.renderW * 0.5f) * (1.0f + P[ 0 ] / P[ 1 ]) );
         };
     int x0 = to_screen_x( A ), x1 = to_screen_x( B );
     if (x0 == x1) return;
     if (x0 > x1)
     {
-        std::swap( x0, x1 ); std::swap( A, B ); std::swap( A0, B0 );
+        std::swap( x0, x1 ); std::swap( A, B ); std::swap( uA, uB );
     }
 
-    // Prepare perspective-correct interpolation:
-    // We'll interpolate q = 1/z and u*q across the screen span.
-    // u is along the segment A->B in world space.
-    auto cam_to_world_u = [&]( float centerX, float centerY ) {
-        // Find world point parameter u via world-space segment parameterization
-        // Using original unclipped endpoints A0,B0 and world endpoints ax,ay..bx,by.
-        // Reconstruct world position by inverting the camera transform is overkill;
-        // we can just compute u by projecting onto the world segment axis using screen-space A/B ratios.
-        // Simpler: compute u from the fraction along the *projected* segment:
-        // This is affine in screen space; to be more accurate we do perspective correction below anyway.
-        (void)centerX; (void)centerY; // not used here (we'll build u from x interpolation)
-        return 0.0f;
-        };
-
-    // Precompute for endpoints:
-    float q0 = 1.0f / std::max( A[ 1 ], NEAR_Z );
-    float q1 = 1.0f / std::max( B[ 1 ], NEAR_Z );
-
-    // texture u at endpoints in world space (0 at A0, 1 at B0)
-    // If x0/x1 got swapped we already swapped A0/B0 with A/B.
-    // So define u0=0, u1=1 consistently with current A->B screen order.
-    float u0 = 0.0f, u1 = 1.0f;
-
-    // We'll interpolate uq = u * q (for perspective correct u)
-    // across screen X from x0..x1.
-    int xBeg = std::max( 0, x0 );
-    int xEnd = std::min( RENDER_W - 1, x1 );
+    int xBeg = std::max( stripBegin, x0 );
+    int xEnd = std::min( stripEnd - 1, x1 );
     if (xBeg > xEnd) return;
 
-    for (int x = xBeg; x <= xEnd; ++x)
+    // q = 1/z and u*q at the endpoints, and their steps per screen column
+    const float q0 = 1.0f / std::max( A[ 1 ], NEAR_Z );
+    const float q1 = 1.0f / std::max( B[ 1 ], NEAR_Z );
+    const float uq0 = uA * q0, uq1 = uB * q1;
+    const float invSpan = 1.0f / float( x1 - x0 );
+    const float qStep = (q1 - q0) * invSpan;
+    const float uqStep = (uq1 - uq0) * invSpan;
+    float q = q0 + qStep * float( xBeg - x0 );
+    float uq = uq0 + uqStep * float( xBeg - x0 );
+
+    for (int x = xBeg; x <= xEnd; ++x, q += qStep, uq += uqStep)
     {
-        // Barycentric t in screen space
-        float t = (x1 == x0) ? 0.0f : ((x - x0) / float( x1 - x0 ));
-
         // Perspective correct depth
-        float q = lerp( q0, q1, t );
-        float z = 1.0f / q;
+        const float z = 1.0f / q;
 
         // Depth test vs walls
         if (z >= engineContext.zbuffer[ x ]) continue;
 
         // Perspective-correct u
-        float uq0 = u0 * q0, uq1 = u1 * q1;
-        float uq = lerp( uq0, uq1, t );
-        float u = std::clamp( uq / q, 0.0f, 1.0f );
+        float u = std::clamp( uq * z, 0.0f, 1.0f );
 
         // Column height for world height = 1
-        int unitH = int( RENDER_H / z );
+        int unitH = int( engineContext.renderH * q );
         // Face occupies "height * unitH" pixels, bottom sits at floor line
         int faceH = std::max( 1, int( height * unitH ) );
-        int bottom = std::min( RENDER_H - 1, RENDER_H / 2 + unitH / 2 );
+        int bottom = std::min( engineContext.renderH - 1, engineContext.renderH / 2 + unitH / 2 );
         int top = std::max( 0, bottom - faceH );
         if (bottom <= top) continue;
 
-        // Texture x from u
-        int textureX = std::clamp( int( u * (texture.width - 1) ), 0, texture.width - 1 );
+        // Mip level for this column's height, then texture x from u
+        const Image &mip = texture.levelFor( texture.height / float( faceH ) );
+        int textureX = std::clamp( int( u * (mip.width - 1) ), 0, mip.width - 1 );
+        const size_t column = mip.columnStart( textureX );
 
         // Simple distance shading
-        float shade = std::clamp( 1.0f / (0.35f * z), 0.25f, 1.0f );
+        const int shade88 = toShade88( std::clamp( q * (1.0f / 0.35f), 0.25f, 1.0f ) );
 
-        // Draw column
+        // Texture v in 16.16 across the face height
         int span = std::max( 1, bottom - top );
-        for (int y = top; y <= bottom; ++y)
-        {
-            float v = (y - top) / float( span );
-            int textureY = std::clamp( int( v * (texture.height - 1) ), 0, texture.height - 1 );
-            Uint32 c = texture.sample( textureX, textureY );
-            // magenta transparent
-            if (((c >> 16) & 255) == 255 && ((c >> 8) & 255) == 0 && (c & 255) == 255) continue;
-
-            if (boolIsNearBlack(c, 120))
+        const Sint64 vStep = std::max<Sint64>( 1, (Sint64( mip.height - 1 ) << 16) / span );
+
+        // Only the covered runs of this texel column (keyed texels were made clear at load)
+        const TexelRun wholeColumn = { 0, Uint16( mip.height ) };
+        const bool hasRuns = !mip.columnRuns.empty();
+        const TexelRun *run = hasRuns ? mip.runs.data() + mip.columnRuns[ textureX ] : &wholeColumn;
+        const TexelRun *runEnd = hasRuns ? mip.runs.data() + mip.columnRuns[ textureX + 1 ] : &wholeColumn + 1;
+        mip.withFetch( [&]( auto fetch ) {
+            for (; run != runEnd; ++run)
             {
-                continue;
-            }
+                // Screen rows whose texel row falls in [begin, end)
+                int yBegin = top + int( ((Sint64( run->begin ) << 16) + vStep - 1) / vStep );
+                int yEnd = top + int( ((Sint64( run->end ) << 16) + vStep - 1) / vStep );
+                yEnd = std::min( yEnd, bottom + 1 );
 
-            Uint8 rr = Uint8( ((c >> 16) & 255) * shade );
-            Uint8 gg = Uint8( ((c >> 8) & 255) * shade );
-            Uint8 bb = Uint8( (c & 255) * shade );
-            putPix( engineContext, x, y, rgb( rr, gg, bb ) );
-        }
+                Sint64 v = Sint64( yBegin - top ) * vStep;
+                for (int y = yBegin; y < yEnd; ++y, v += vStep)
+                {
+                    int textureY = std::min( int( v >> 16 ), mip.height - 1 );
+                    Uint32 c = mip.columnMajor ? fetch( column + textureY ) : mip.sample( textureX, textureY );
+                    const int alpha = int( c >> 24 );
+                    blendPix( engineContext, x, y, colorMul( c, shade88 ), alpha );
+                    if (id && alpha >= 128) putId( engineContext, x, y, id );
+                }
+            }
+            } );
     }
 }
 
@@ -864,128 +819,188 @@ inline void box_corners( const BoxProp &box, float &x0, float &y0, float &x1, fl
     y3 = box.centerY - uy + vy;
 }
 
-inline void render_box( Engine &engineContext, const BoxProp &box ) {
-    float x0, y0, x1, y1, x2, y2, x3, y3;
-    box_corners( box, x0, y0, x1, y1, x2, y2, x3, y3 );
-
-    const Image &texture = box.sideTexure;
-
-    // Four faces around the seat (0-1, 1-2, 2-3, 3-0)
-    draw_vertical_face( engineContext, x0, y0, x1, y1, box.height, texture );
-    draw_vertical_face( engineContext, x1, y1, x2, y2, box.height, texture );
-    draw_vertical_face( engineContext, x2, y2, x3, y3, box.height, texture );
-    draw_vertical_face( engineContext, x3, y3, x0, y0, box.height, texture );
+// Whether a box texture hides what is behind it: at most one texel in 256 is clear
+// (stray dark texels caught by the near-black key). Counted from the covered runs.
+inline bool isSolidTexture( const Image &texture ) {
+    if (texture.columnRuns.empty()) return !texture.hasAlpha;
+    size_t covered = 0;
+    for (const TexelRun &run : texture.runs) covered += run.end - run.begin;
+    const size_t clear = size_t( texture.width ) * texture.height - covered;
+    return clear * 256 <= size_t( texture.width ) * texture.height;
 }
 
-inline void render_legs( Engine &engineContext, const BoxProp &box ) {
-    const float c = std::cos( box.angle );
-    const float s = std::sin( box.angle );
-    const float ux = box.halfLength * c, uy = box.halfLength * s;
-    const float vx = -box.halfDepth * s, vy = box.halfDepth * c;
+// Appends the world-space faces of a box (four sides) and its legs (four small boxes,
+// when legHalf > 0) to boxFaces, once at load. Side faces run corner 0-1, 1-2, 2-3, 3-0.
+inline void buildBoxFaces( Engine &engineContext, BoxProp &box ) {
+    box.firstFace = (int)engineContext.boxFaces.size();
+    auto addSides = [&]( const BoxProp &shape, int texture ) {
+        const bool solid = isSolidTexture( engineContext.boxTextures[ texture ] );
+        float x[ 4 ], y[ 4 ];
+        box_corners( shape, x[ 0 ], y[ 0 ], x[ 1 ], y[ 1 ], x[ 2 ], y[ 2 ], x[ 3 ], y[ 3 ] );
+        for (int i = 0; i < 4; ++i)
+        {
+            BoxFace face;
+            face.ax = x[ i ];
+            face.ay = y[ i ];
+            face.bx = x[ (i + 1) & 3 ];
+            face.by = y[ (i + 1) & 3 ];
+            face.height = shape.height;
+            face.texture = texture;
+            face.solid = solid;
+            engineContext.boxFaces.push_back( face );
+        }
+        };
 
-    const float insetU = std::max( 0.f, box.halfLength - box.legInsetLength );
-    const float insetV = std::max( 0.f, box.halfDepth - box.legInsetDepth );
+    // Seat
+    addSides( box, box.sideTexture );
 
-    // leg centers (four corners, inset)
-    struct P
+    // Legs, at the four corners inset along length and depth
+    if (box.legHalf > 0.0f)
     {
-        float x, y;
-    };
-    P centers[ 4 ] = {
-        { box.centerX - insetU * c - insetV * (-s), box.centerY - insetU * s - insetV * (c) }, // near-left
-        { box.centerX + insetU * c - insetV * (-s), box.centerY + insetU * s - insetV * (c) }, // near-right
-        { box.centerX + insetU * c + insetV * (-s), box.centerY + insetU * s + insetV * (c) }, // far-right
-        { box.centerX - insetU * c + insetV * (-s), box.centerY - insetU * s + insetV * (c) }  // far-left
-    };
-
-    const float width = box.legHalf; // half width (square leg)
-    const Image &texture = (box.legTexure.width > 0 && box.legTexure.height > 0) ? box.legTexure : box.sideTexure;
+        const float c = std::cos( box.angle );
+        const float s = std::sin( box.angle );
+        const float insetU = std::max( 0.f, box.halfLength - box.legInsetLength );
+        const float insetV = std::max( 0.f, box.halfDepth - box.legInsetDepth );
+        const float signU[ 4 ] = { -1.f, 1.f, 1.f, -1.f }; // near-left, near-right, far-right, far-left
+        const float signV[ 4 ] = { -1.f, -1.f, 1.f, 1.f };
+        const int legTexture = box.legTexture >= 0 ? box.legTexture : box.sideTexture;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            BoxProp leg;
+            leg.centerX = box.centerX + signU[ i ] * insetU * c - signV[ i ] * insetV * s;
+            leg.centerY = box.centerY + signU[ i ] * insetU * s + signV[ i ] * insetV * c;
+            leg.halfLength = box.legHalf;
+            leg.halfDepth = box.legHalf;
+            leg.height = box.height; // full height to floor
+            leg.angle = box.angle;
+            addSides( leg, legTexture );
+        }
+    }
+    box.faceCount = (int)engineContext.boxFaces.size() - box.firstFace;
+}
 
-    for (int i = 0; i < 4; ++i)
+// Draws a box's prebuilt faces; no per-frame geometry or texture work.
+// Corners run CCW, so a face whose inner (left) side holds the camera faces away. Those
+// are culled on solid textures and drawn first on see-through ones, under the front faces.
+inline void render_box( Engine &engineContext, const BoxProp &box, int stripBegin, int stripEnd, Uint16 id = 0 ) {
+    const BoxFace *first = engineContext.boxFaces.data() + box.firstFace;
+    const BoxFace *last = first + box.faceCount;
+    auto facesCamera = [&]( const BoxFace &face ) {
+        return cross2( face.bx - face.ax, face.by - face.ay, engineContext.positionX - face.ax, engineContext.positionY - face.ay ) < 0.0f;
+        };
+    auto draw = [&]( const BoxFace &face ) {
+        draw_vertical_face( engineContext, face.ax, face.ay, face.bx, face.by, face.height, engineContext.boxTextures[ face.texture ], stripBegin, stripEnd, id );
+        };
+
+    for (const BoxFace *face = first; face != last; ++face)
     {
-        // A leg is a tiny axis-aligned (by bench) box around centers[i].
-        // Build its 4 side faces in world space (just like seat, with much smaller halfLength/halfDepth).
-        BoxProp leg;
-        leg.centerX = centers[ i ].x; leg.centerY = centers[ i ].y;
-        leg.halfLength = width; leg.halfDepth = width;
-        leg.height = box.height;    // full height to floor
-        leg.angle = box.angle;
-        leg.sideTexure = texture;
-
-        float x0, y0, x1, y1, x2, y2, x3, y3;
-        box_corners( leg, x0, y0, x1, y1, x2, y2, x3, y3 );
-
-        draw_vertical_face( engineContext, x0, y0, x1, y1, leg.height, texture );
-        draw_vertical_face( engineContext, x1, y1, x2, y2, leg.height, texture );
-        draw_vertical_face( engineContext, x2, y2, x3, y3, leg.height, texture );
-        draw_vertical_face( engineContext, x3, y3, x0, y0, leg.height, texture );
+        if (!face->solid && !facesCamera( *face )) draw( *face );
+    }
+    for (const BoxFace *face = first; face != last; ++face)
+    {
+        if (facesCamera( *face )) draw( *face );
     }
 }
 
-inline void render_box_top( Engine &engineContext, const BoxProp &box, const Image &texture ) {
-    const int half = RENDER_H / 2;
-    const float posZ = 0.5f * RENDER_H;
+// Box top: a horizontal quad at the box height, seen from above. Each lower-half screen row
+// sees that plane at a single depth, so the world point, and with it the box-local u and v,
+// is linear along the row (perspective correct as is). Clipping that line against the
+// box's u and v slabs gives the covered span; only rows between the farthest and nearest
+// corner are visited. Pixels at least half covered get object id (0 writes none).
+inline void render_box_top( Engine &engineContext, const BoxProp &box, const Image &texture, int stripBegin, int stripEnd, Uint16 id = 0 ) {
+    const int half = engineContext.renderH / 2;
+    const float posZ = 0.5f * engineContext.renderH;
     const float camZ = 0.5f;
 
     // Tiny lowering so the cap matches the side tops in screen space
-    const float heightBias = 0.003f;                 
-    const float planeZ = std::clamp( box.height - heightBias, 0.0f, camZ - 1e-4f );
+    const float heightBias = 0.003f;
+    if (box.height - heightBias >= camZ) return; // at or above eye level, the top can't be seen
+    const float planeZ = std::max( box.height - heightBias, 0.0f );
 
     const float alpha = (camZ - planeZ) / camZ;
     if (alpha <= 0.0f) return;
 
-    // Bench local half-axes (world space vectors)
+    // Bench local axes, scaled so the top spans -1..1 along each
     const float c = std::cos( box.angle ), s = std::sin( box.angle );
-    const float ux = box.halfLength * c, uy = box.halfLength * s;
-    const float vx = -box.halfDepth * s, vy = box.halfDepth * c;
+    const float ux = c / box.halfLength, uy = s / box.halfLength;
+    const float vx = -s / box.halfDepth, vy = c / box.halfDepth;
+
+    // Rows the top can cover: row p = y - half sees the plane at depth rowScale / p
+    const float rowScale = posZ * alpha;
+    const float invDet = 1.0f / (engineContext.planeX * engineContext.directionY - engineContext.directionX * engineContext.planeY);
+    float corners[ 8 ];
+    box_corners( box, corners[ 0 ], corners[ 1 ], corners[ 2 ], corners[ 3 ], corners[ 4 ], corners[ 5 ], corners[ 6 ], corners[ 7 ] );
+    float nearDepth = 1e9f, farDepth = -1e9f;
+    for (int i = 0; i < 4; ++i)
+    {
+        float dx = corners[ 2 * i ] - engineContext.positionX, dy = corners[ 2 * i + 1 ] - engineContext.positionY;
+        float depth = invDet * (-engineContext.planeY * dx + engineContext.planeX * dy);
+        nearDepth = std::min( nearDepth, depth );
+        farDepth = std::max( farDepth, depth );
+    }
+    if (farDepth <= 0.0f) return; // behind the camera
+    const int yBeg = half + std::max( 1, int( rowScale / farDepth ) );
+    const int yEnd = nearDepth > rowScale / float( engineContext.renderH - half ) ? half + int( rowScale / nearDepth ) + 1 : engineContext.renderH - 1;
 
     // edge rays 
     const float rdx0 = engineContext.directionX - engineContext.planeX, rdy0 = engineContext.directionY - engineContext.planeY;
     const float rdx1 = engineContext.directionX + engineContext.planeX, rdy1 = engineContext.directionY + engineContext.planeY;
 
-    for (int y = half + 1; y < RENDER_H; ++y)
+    const float insideEps = 1.001f;          // ~0.1% leniency
+    // -1..1 to texture 0..1, squeezed by the leniency so border texels are still reached
+    const float invSpan = 0.5f * (1.0f / insideEps);
+
+    for (int y = yBeg; y <= std::min( yEnd, engineContext.renderH - 1 ); ++y)
     {
         const int   p = y - half;
         const float baseRowDist = posZ / float( p );
         const float rowDist = baseRowDist * alpha;
 
-        float stepX = rowDist * (rdx1 - rdx0) / float( RENDER_W );
-        float stepY = rowDist * (rdy1 - rdy0) / float( RENDER_W );
-        float worldX = engineContext.positionX + rowDist * rdx0;
-        float worldY = engineContext.positionY + rowDist * rdy0;
-
-        for (int x = 0; x < RENDER_W; ++x)
-        {
-            if (rowDist < engineContext.zbuffer[ x ])
+        // Box-local u, v at column 0 and their steps per column
+        float stepX = rowDist * (rdx1 - rdx0) / float( engineContext.renderW );
+        float stepY = rowDist * (rdy1 - rdy0) / float( engineContext.renderW );
+        const float dx = engineContext.positionX + rowDist * rdx0 - box.centerX;
+        const float dy = engineContext.positionY + rowDist * rdy0 - box.centerY;
+        const float u0 = dx * ux + dy * uy, uStep = stepX * ux + stepY * uy;
+        const float v0 = dx * vx + dy * vy, vStep = stepX * vx + stepY * vy;
+
+        // Columns where |u| and |v| stay within the top
+        float xLo = float( stripBegin ), xHi = float( stripEnd - 1 );
+        auto clipSlab = [&]( float start, float step ) {
+            if (std::fabs( step ) < 1e-9f) return std::fabs( start ) <= insideEps;
+            float t0 = (-insideEps - start) / step, t1 = (insideEps - start) / step;
+            if (t0 > t1) std::swap( t0, t1 );
+            xLo = std::max( xLo, t0 );
+            xHi = std::min( xHi, t1 );
+            return xLo <= xHi;
+            };
+        if (!clipSlab( u0, uStep ) || !clipSlab( v0, vStep )) continue;
+        const int xb = int( std::ceil( xLo ) ), xe = int( std::floor( xHi ) );
+
+        const int shade88 = toShade88( std::clamp( 1.0f / (0.02f * rowDist), 0.30f, 1.0f ) );
+
+        // Mip for this row's texel footprint, then texel u, v in 16.16 stepped per column
+        const float texelsPerPixel = std::max( std::fabs( uStep ), std::fabs( vStep ) ) * invSpan * float( std::max( texture.width, texture.height ) );
+        const Image &mip = texture.levelFor( texelsPerPixel );
+        const float toTexU = invSpan * float( mip.width ) * 65536.0f, toTexV = invSpan * float( mip.height ) * 65536.0f;
+        int fu = int( (u0 + uStep * float( xb )) * toTexU + float( mip.width ) * 32768.0f );
+        int fv = int( (v0 + vStep * float( xb )) * toTexV + float( mip.height ) * 32768.0f );
+        const int fuStep = int( uStep * toTexU ), fvStep = int( vStep * toTexV );
+        mip.withFetch( [&]( auto fetch ) {
+            for (int x = xb; x <= xe; ++x, fu += fuStep, fv += fvStep)
             {
-                const float dx = worldX - box.centerX, dy = worldY - box.centerY;
-
-                const float invLL = 1.0f / (box.halfLength * box.halfLength);
-                const float invDD = 1.0f / (box.halfDepth * box.halfDepth);
-                float du = (dx * ux + dy * uy) * invLL;   // [-1,1] ideally
-                float dv = (dx * vx + dy * vy) * invDD;
+                if (rowDist >= engineContext.zbuffer[ x ]) continue;
 
-                const float insideEps = 1.001f;          // ~0.1% leniency
-                if (std::fabs( du ) <= insideEps && std::fabs( dv ) <= insideEps)
-                {
-                    // so bilinear can pick the border texels
-                    const float invSpan = 0.5f * (1.0f / insideEps);
-                    float u = du * invSpan + 0.5f;
-                    float v = dv * invSpan + 0.5f;
+                const int textureX = std::clamp( fu >> 16, 0, mip.width - 1 );
+                const int textureY = std::clamp( fv >> 16, 0, mip.height - 1 );
+                Uint32 color = mip.columnMajor ? fetch( mip.columnStart( textureX ) + textureY ) : mip.sample( textureX, textureY );
+                const int alpha = int( color >> 24 );
+                if (alpha == 0) continue;
 
-                    Uint32 color = sample_bilinear_uv_keyed( texture, u, v );
-                    if (!(((color >> 16) & 255) == 255 && ((color >> 8) & 255) == 0 && (color & 255) == 255))
-                    {
-                        float sh = std::clamp( 1.0f / (0.02f * rowDist), 0.30f, 1.0f );
-                        Uint8 r = Uint8( ((color >> 16) & 255) * sh );
-                        Uint8 g = Uint8( ((color >> 8) & 255) * sh );
-                        Uint8 bcol = Uint8( (color & 255) * sh );
-                        putPix( engineContext, x, y, rgb( r, g, bcol ) );
-                    }
-                }
+                blendPix( engineContext, x, y, colorMul( color, shade88 ), alpha );
+                if (id && alpha >= 128) putId( engineContext, x, y, id );
             }
-            worldX += stepX; 
-            worldY += stepY;
-        }
+            } );
     }
 }
@@ -1,8 +1,40 @@
+#pragma once
 namespace config
 {
 	bool useVerboseDescriptions = false;
 	bool useMusic = true;
 	bool showMainMenu = false;
+
+	// Render threads for the strip renderer (0 = one per hardware thread)
+	int renderThreads = 0;
+
+	// Frames in flight: 1 renders and presents in order, 2 presents frame N while
+	// frame N+1 rasterizes, 3 keeps one more finished frame queued
+	int pipelineDepth = 2;
+
+	// Trace wall rays 4 columns at a time in SIMD lanes
+	bool packetRays = true;
+
+	// Render the world into a column-major target (contiguous wall/sprite columns) and
+	// transpose it back to rows before the UI is drawn
+	bool columnMajorTarget = false;
+
+	// Memory for wall faces baked with their artwork, frame and mat (0 = composite them
+	// every frame instead)
+	int surfaceCacheMB = 32;
+
+	// Write an object id per pixel during the world pass (artworks, props, benches,
+	// doors); picking reads it instead of casting a ray
+	bool objectIdBuffer = true;
+
+	// Scale the world pass down when it takes longer than frameBudgetMs, and back up when
+	// there is headroom; the UI always draws at full size
+	bool dynamicResolution = true;
+	float frameBudgetMs = 13.0f;
+
+	// Keep the last frame on screen while nothing it shows changes, and sleep on events
+	// instead of rendering every vsync
+	bool idleWhenStatic = true;
 }
 
 namespace debug{
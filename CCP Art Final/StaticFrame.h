@@ -0,0 +1,74 @@
+#pragma once
+#include "GameEngine.h"
+
+// Static frames (config::idleWhenStatic). After each rendered frame the main loop keeps
+// what it showed: camera, level, prop and box counts and the UI state. While the state
+// stays the same the window keeps that frame, nothing is rendered or presented, and the
+// loop sleeps in SDL_WaitEventTimeout until an event comes, a UI timer runs out or the
+// music is due a check. Changes the state doesn't cover (door toggles, level loads,
+// window events) invalidate the frame instead. A still view that was shown scaled down
+// first renders once at full size, so idling never keeps a reduced frame.
+
+static FrameState currentFrameState( const Engine &engineContext ) {
+    FrameState state;
+    state.positionX = engineContext.positionX;
+    state.positionY = engineContext.positionY;
+    state.directionX = engineContext.directionX;
+    state.directionY = engineContext.directionY;
+    state.level = int( engineContext.currentLevel );
+    state.props = engineContext.props.size();
+    state.boxes = engineContext.benches3D.size();
+    state.showHelp = engineContext.showHelp;
+    state.placardOpen = engineContext.placardOpen;
+    state.journalOpen = engineContext.journalOpen;
+    state.inRangeOfStatue = engineContext.inRangeOfStatue;
+    state.statueChatActive = engineContext.statueChatActive;
+    state.openArtId = engineContext.openArtId;
+    return state;
+}
+
+static bool sameFrameState( const FrameState &a, const FrameState &b ) {
+    return a.positionX == b.positionX && a.positionY == b.positionY &&
+        a.directionX == b.directionX && a.directionY == b.directionY &&
+        a.level == b.level && a.props == b.props && a.boxes == b.boxes &&
+        a.showHelp == b.showHelp && a.placardOpen == b.placardOpen && a.journalOpen == b.journalOpen &&
+        a.inRangeOfStatue == b.inRangeOfStatue && a.statueChatActive == b.statueChatActive &&
+        a.openArtId == b.openArtId;
+}
+
+// The next frame renders whatever the state says
+static void invalidateFrame( Engine &engineContext ) {
+    engineContext.staticFrame.valid = false;
+}
+
+// Called after each rendered frame
+static void keepFrameState( Engine &engineContext ) {
+    engineContext.staticFrame.shown = currentFrameState( engineContext );
+    engineContext.staticFrame.valid = true;
+}
+
+// True when the last frame still shows everything as it is, at whatever size it rendered
+static bool frameIsCurrent( const Engine &engineContext ) {
+    const auto &frame = engineContext.staticFrame;
+    return config::idleWhenStatic && frame.valid && sameFrameState( frame.shown, currentFrameState( engineContext ) );
+}
+
+// True when the last frame can stay on screen. A frame dynamic resolution scaled down
+// doesn't: the view renders once more at full size first (see the main loop).
+static bool frameIsStatic( const Engine &engineContext ) {
+    return frameIsCurrent( engineContext ) && engineContext.resolution.level == 0;
+}
+
+// How long an idle loop may sleep: until the next music check or the first UI timer
+static int idleWaitMs( const Engine &engineContext, Uint32 now ) {
+    Sint64 wait = IDLE_WAKE_MS;
+    if (engineContext.statueChatActive)
+    {
+        wait = std::min<Sint64>( wait, Sint64( engineContext.statueChatStartTick ) + STATUE_CHAT_MS + 1 - now );
+    }
+    if (engineContext.placardOpen)
+    {
+        wait = std::min<Sint64>( wait, Sint64( engineContext.lastPlacardTick ) + PLACARD_KEEP_MS + 1 - now );
+    }
+    return int( std::max<Sint64>( 0, wait ) );
+}
@@ -0,0 +1,269 @@
+#pragma once
+#include "GameEngine.h"
+#include "RendererHelpers.h"
+#include "PhysicsHelpers.h"
+#include "Lighting.h"
+
+// Surface cache. A wall face with artworks on it is baked once into its own texture:
+// the wall texels, then each artwork's frame, mat and image, with mips. Its columns
+// then sample one image instead of compositing the frame per pixel. Columns that miss
+// draw the old way and note the face; between frames a few missed faces are baked and
+// the least recently drawn ones are evicted to stay under config::surfaceCacheMB.
+//
+// Artworks have always drawn unshaded over the distance-shaded wall, so a surface
+// texel's alpha says how much of the wall light applies: 255 on wall, 0 on artwork.
+// Mips average it like the colors, so the frame edge fades between the two.
+
+// Frame and mat widths, as fractions of the artwork band
+static const float ART_FRAME_U = 0.08f, ART_FRAME_V = 0.08f;
+static const float ART_MAT_U = 0.03f, ART_MAT_V = 0.04f;
+
+// Artwork color at (uLocal, vLocal), 0..1 across its band: gold frame, mat, then image
+static Uint32 artworkTexel( const Image &texture, float uLocal, float vLocal ) {
+    const Uint32 goldLight = rgb( 235, 200, 80 );
+    const Uint32 goldMid = rgb( 212, 175, 55 );
+    const Uint32 goldDark = rgb( 160, 130, 40 );
+    const Uint32 matCol = rgb( 235, 235, 220 );
+
+    const float uLeftFrameEdge = ART_FRAME_U;
+    const float uRightFrameEdge = 1.0f - ART_FRAME_U;
+    const float vTopFrameEdge = ART_FRAME_V;
+    const float vBottomFrameEdge = 1.0f - ART_FRAME_V;
+
+    bool inFrame =
+        (uLocal < uLeftFrameEdge) || (uLocal > uRightFrameEdge) ||
+        (vLocal < vTopFrameEdge) || (vLocal > vBottomFrameEdge);
+
+    if (inFrame)
+    {
+        bool topOrLeft = (vLocal < vTopFrameEdge + 0.02f) || (uLocal < uLeftFrameEdge + 0.02f);
+        bool bottomOrRight = (vLocal > vBottomFrameEdge - 0.02f) || (uLocal > uRightFrameEdge - 0.02f);
+        if (topOrLeft) return goldLight;
+        if (bottomOrRight) return goldDark;
+        return goldMid;
+    }
+
+    const float uLeftMatEdge = ART_FRAME_U + ART_MAT_U;
+    const float uRightMatEdge = 1.0f - (ART_FRAME_U + ART_MAT_U);
+    const float vTopMatEdge = ART_FRAME_V + ART_MAT_V;
+    const float vBottomMatEdge = 1.0f - (ART_FRAME_V + ART_MAT_V);
+
+    bool inMat =
+        (uLocal < uLeftMatEdge) || (uLocal > uRightMatEdge) ||
+        (vLocal < vTopMatEdge) || (vLocal > vBottomMatEdge);
+
+    if (inMat) return matCol;
+
+    float un = (uLocal - uLeftMatEdge) / std::max( 0.0001f, (uRightMatEdge - uLeftMatEdge) );
+    float vn = (vLocal - vTopMatEdge) / std::max( 0.0001f, (vBottomMatEdge - vTopMatEdge) );
+    int texX = std::clamp( int( un * (texture.width - 1) ), 0, texture.width - 1 );
+    int texY = std::clamp( int( vn * (texture.height - 1) ), 0, texture.height - 1 );
+    Uint32 color = texture.sample( texX, texY );
+
+    // clear (keyed) texels show the mat
+    return colorBlendOver( matCol, color, int( color >> 24 ) );
+}
+
+// Screen rows of an artwork's band on a wall column lineH pixels tall, clamped to a
+// screen renderH rows tall
+static void artworkBand( const Artwork &art, int lineH, int renderH, int &bandH, int &bandStart, int &bandEnd ) {
+    bandH = std::max( 1, int( lineH * art.vHeight ) );
+    int bandCenter = renderH / 2 + int( (art.vCenter - 0.5f) * lineH );
+    bandStart = std::clamp( bandCenter - bandH / 2, 0, renderH - 1 );
+    bandEnd = std::clamp( bandStart + bandH - 1, 0, renderH - 1 );
+}
+
+// Baked size of a face: the wall texture doubled until every artwork image on the face
+// fits about 1:1, up to SURFACE_MAX_SIZE. Whole multiples of the wall texture keep its
+// texels and mips the same as on undecorated walls.
+static void surfaceSize( const Engine &engineContext, const std::vector<ArtworkSpan> &spans, int &width, int &height ) {
+    float needU = 1.0f, needV = 1.0f;
+    for (const ArtworkSpan &span : spans)
+    {
+        const Artwork &art = engineContext.artworks[ span.artIndex ];
+        const Image &artImage = engineContext.artImages[ span.artIndex ];
+        float imageU = (span.u1 - span.u0) * (1.0f - 2.0f * (ART_FRAME_U + ART_MAT_U));
+        float imageV = art.vHeight * (1.0f - 2.0f * (ART_FRAME_V + ART_MAT_V));
+        needU = std::max( needU, artImage.width / std::max( 0.0001f, imageU ) );
+        needV = std::max( needV, artImage.height / std::max( 0.0001f, imageV ) );
+    }
+    width = std::max( 1, engineContext.wallTex.width );
+    height = std::max( 1, engineContext.wallTex.height );
+    while (width < needU && width * 2 <= SURFACE_MAX_SIZE) width *= 2;
+    while (height < needV && height * 2 <= SURFACE_MAX_SIZE) height *= 2;
+}
+
+// Bytes of a width x height ARGB8888 image and its mip chain
+static size_t surfaceBytes( int width, int height ) {
+    size_t bytes = size_t( width ) * height * 4;
+    while (width > 1 || height > 1)
+    {
+        width = std::max( 1, width / 2 );
+        height = std::max( 1, height / 2 );
+        bytes += size_t( width ) * height * 4;
+    }
+    return bytes;
+}
+
+static void bakeSurface( const Engine &engineContext, int face, Surface &surface ) {
+    const std::vector<ArtworkSpan> &spans = engineContext.artworkFaces[ face ];
+    int width, height;
+    surfaceSize( engineContext, spans, width, height );
+
+    const Image &wall = engineContext.wallTex;
+    const Engine::GrayTex *wallMul = engineContext.hasWallMul ? &engineContext.wallMul : nullptr;
+    const bool overlay = engineContext.caveMode && engineContext.hasWallOverlay;
+
+    Image &image = surface.image;
+    image.fill( width, height, 0 );
+    image.columnMajor = true; // written column by column below
+    for (int x = 0; x < width; ++x)
+    {
+        const float u = (x + 0.5f) / width;
+        const int textureX = x * wall.width / width;
+        for (int y = 0; y < height; ++y)
+        {
+            const float v = (y + 0.5f) / height;
+            const int textureY = y * wall.height / height;
+
+            // Wall texel with the same stains and overlay tint as drawTexturedColumn
+            Uint32 color = wall.sample( textureX, textureY );
+            if (wallMul)
+            {
+                int mx = textureX * wallMul->width / wall.width;
+                int my = textureY * wallMul->height / wall.height;
+                color = colorMul( color, byteToMul88( wallMul->data[ my * wallMul->width + mx ] ) );
+            }
+            if (overlay)
+            {
+                Uint32 o = engineContext.wallOverlay.sample( textureX % engineContext.wallOverlay.width, textureY % engineContext.wallOverlay.height );
+                int mr = 218 + ((((o >> 16) & 255) * 51) >> 8);
+                int mg = 218 + ((((o >> 8) & 255) * 51) >> 8);
+                int mb = 218 + (((o & 255) * 51) >> 8);
+                color = colorMulRGB( color, mr, mg, mb );
+            }
+            color |= 0xFF000000u;
+
+            // Artworks in span order, later ones on top
+            for (const ArtworkSpan &span : spans)
+            {
+                if (span.u0 > u) break;
+                if (u > span.u1) continue;
+                const Artwork &art = engineContext.artworks[ span.artIndex ];
+                float vTop = art.vCenter - 0.5f * art.vHeight;
+                if (v < vTop || v > vTop + art.vHeight) continue;
+
+                const Image &artImage = engineContext.artImages[ span.artIndex ];
+                const Image &texture = artImage.levelFor( artImage.height / (art.vHeight * height) );
+                float uLocal = (u - span.u0) / std::max( 0.0001f, span.u1 - span.u0 );
+                float vLocal = (v - vTop) / std::max( 0.0001f, art.vHeight );
+                color = artworkTexel( texture, uLocal, vLocal ) & 0x00FFFFFFu;
+            }
+            image.pixels[ image.columnStart( x ) + y ] = color;
+        }
+    }
+    image.buildMips();
+    surface.bytes = surfaceBytes( width, height );
+}
+
+// Baked surface for a wall face, or nullptr when the face has no artworks or isn't baked
+// yet. Notes the face for updateSurfaceCache either way. Called from the render workers.
+static const Surface *findSurface( const Engine &engineContext, StripScratch &scratch, int mapX, int mapY, int side ) {
+    if (config::surfaceCacheMB <= 0) return nullptr;
+    int face = wallFaceIndex( engineContext, mapX, mapY, side );
+    if (face < 0 || face >= (int)engineContext.artworkFaces.size() || engineContext.artworkFaces[ face ].empty()) return nullptr;
+
+    if (scratch.surfaceFaces.empty() || scratch.surfaceFaces.back() != face) scratch.surfaceFaces.push_back( face );
+    auto it = engineContext.surfaces.faces.find( face );
+    return it != engineContext.surfaces.faces.end() ? &it->second : nullptr;
+}
+
+// Between frames (no workers running): marks the faces drawn last frame as used, bakes
+// up to SURFACE_BAKES_PER_FRAME that missed, evicting the least recently drawn faces to
+// make room. A face that can't fit without evicting one in view stays uncached.
+static void updateSurfaceCache( Engine &engineContext ) {
+    SurfaceCache &cache = engineContext.surfaces;
+    const size_t budget = size_t( std::max( 0, config::surfaceCacheMB ) ) << 20;
+    ++cache.frame;
+
+    std::vector<int> missed;
+    for (StripScratch &scratch : engineContext.stripScratch)
+    {
+        for (int face : scratch.surfaceFaces)
+        {
+            auto it = cache.faces.find( face );
+            if (it != cache.faces.end()) it->second.lastUsed = cache.frame;
+            else if (std::find( missed.begin(), missed.end(), face ) == missed.end()) missed.push_back( face );
+        }
+        scratch.surfaceFaces.clear();
+    }
+
+    auto evictOldest = [&]() {
+        auto oldest = cache.faces.end();
+        for (auto it = cache.faces.begin(); it != cache.faces.end(); ++it)
+        {
+            if (it->second.lastUsed == cache.frame) continue;
+            if (oldest == cache.faces.end() || it->second.lastUsed < oldest->second.lastUsed) oldest = it;
+        }
+        if (oldest == cache.faces.end()) return false;
+        cache.bytes -= oldest->second.bytes;
+        cache.faces.erase( oldest );
+        return true;
+        };
+
+    int baked = 0;
+    for (int face : missed)
+    {
+        if (baked >= SURFACE_BAKES_PER_FRAME) break;
+        // The face list may be from before a level change
+        if (face >= (int)engineContext.artworkFaces.size() || engineContext.artworkFaces[ face ].empty()) continue;
+
+        int width, height;
+        surfaceSize( engineContext, engineContext.artworkFaces[ face ], width, height );
+        const size_t bytes = surfaceBytes( width, height );
+        while (cache.bytes + bytes > budget && evictOldest()) {}
+        if (cache.bytes + bytes > budget) continue;
+
+        Surface &surface = cache.faces[ face ];
+        bakeSurface( engineContext, face, surface );
+        surface.lastUsed = cache.frame;
+        cache.bytes += surface.bytes;
+        ++baked;
+    }
+
+    // The budget may have shrunk
+    while (cache.bytes > budget && evictOldest()) {}
+}
+
+static void clearSurfaceCache( Engine &engineContext ) {
+    engineContext.surfaces.faces.clear();
+    engineContext.surfaces.bytes = 0;
+}
+
+// drawTexturedColumn for a baked surface: one texel fetch per row, with the column's
+// distance shade weighted by texel alpha
+static void drawSurfaceColumn( Engine &engineContext, const Surface &surface, int x, int drawStart, int drawEnd, float perpDist, float wallX ) {
+    const int lineH = std::max( 1, int( engineContext.renderH / std::max( perpDist, 1e-3f ) ) );
+    const Image &texture = surface.image.levelFor( surface.image.height / float( lineH ) );
+    const int textureW = texture.width;
+    const int textureH = texture.height;
+    const int textureX = std::clamp( int( wallX * float( textureW ) ), 0, textureW - 1 );
+    const int shade88 = toShade88( lightLevelShade( engineContext.wallLight.levelAt( perpDist ) ) );
+
+    const int wallTopY = -lineH / 2 + engineContext.renderH / 2;
+    const Uint32 *column = texture.pixels.data() + texture.columnStart( textureX );
+
+    // Texture v in 16.16, stepped once per screen row
+    const Sint64 vStep = (Sint64( textureH ) << 16) / lineH;
+    Sint64 v = Sint64( drawStart - wallTopY ) * vStep;
+
+    Uint32 *out = &targetPixel( engineContext, x, drawStart );
+    const int outStep = engineContext.targetStepY;
+
+    for (int y = drawStart; y <= drawEnd; ++y, v += vStep, out += outStep)
+    {
+        Uint32 color = column[ std::min( int( v >> 16 ), textureH - 1 ) ];
+        int lit = byteToMul88( int( color >> 24 ) );
+        *out = colorMul( color, 256 - (((256 - shade88) * lit) >> 8) );
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include "Includes.h"
+
+// Cache-blocked 32-bit transposes between row-major and column-major pixel buffers.
+// dst[ c * dstStride + r ] = src[ r * srcStride + c ] for r < rows, c < cols.
+// Work goes in 16x16 blocks (two 1 KB tiles in L1) made of 4x4 SSE2 transposes.
+
+static const int TRANSPOSE_BLOCK = 16;
+
+#if HAS_SSE2
+inline void transpose4x4( const Uint32 *src, int srcStride, __m128i &r0, __m128i &r1, __m128i &r2, __m128i &r3 ) {
+    __m128i a = _mm_loadu_si128( (const __m128i *)(src) );
+    __m128i b = _mm_loadu_si128( (const __m128i *)(src + srcStride) );
+    __m128i c = _mm_loadu_si128( (const __m128i *)(src + 2 * srcStride) );
+    __m128i d = _mm_loadu_si128( (const __m128i *)(src + 3 * srcStride) );
+    __m128i ab0 = _mm_unpacklo_epi32( a, b ), ab1 = _mm_unpackhi_epi32( a, b );
+    __m128i cd0 = _mm_unpacklo_epi32( c, d ), cd1 = _mm_unpackhi_epi32( c, d );
+    r0 = _mm_unpacklo_epi64( ab0, cd0 );
+    r1 = _mm_unpackhi_epi64( ab0, cd0 );
+    r2 = _mm_unpacklo_epi64( ab1, cd1 );
+    r3 = _mm_unpackhi_epi64( ab1, cd1 );
+}
+#endif
+
+static void transposePixels( const Uint32 *src, int srcStride, Uint32 *dst, int dstStride, int rows, int cols ) {
+    for (int rb = 0; rb < rows; rb += TRANSPOSE_BLOCK)
+    {
+        int rEnd = std::min( rows, rb + TRANSPOSE_BLOCK );
+        for (int cb = 0; cb < cols; cb += TRANSPOSE_BLOCK)
+        {
+            int cEnd = std::min( cols, cb + TRANSPOSE_BLOCK );
+            int r = rb;
+#if HAS_SSE2
+            for (; r + 4 <= rEnd; r += 4)
+            {
+                int c = cb;
+                for (; c + 4 <= cEnd; c += 4)
+                {
+                    __m128i t0, t1, t2, t3;
+                    transpose4x4( src + r * srcStride + c, srcStride, t0, t1, t2, t3 );
+                    _mm_storeu_si128( (__m128i *)(dst + (c + 0) * dstStride + r), t0 );
+                    _mm_storeu_si128( (__m128i *)(dst + (c + 1) * dstStride + r), t1 );
+                    _mm_storeu_si128( (__m128i *)(dst + (c + 2) * dstStride + r), t2 );
+                    _mm_storeu_si128( (__m128i *)(dst + (c + 3) * dstStride + r), t3 );
+                }
+                for (; c < cEnd; ++c)
+                {
+                    for (int k = 0; k < 4; ++k) dst[ c * dstStride + r + k ] = src[ (r + k) * srcStride + c ];
+                }
+            }
+#endif
+            for (; r < rEnd; ++r)
+            {
+                for (int c = cb; c < cEnd; ++c) dst[ c * dstStride + r ] = src[ r * srcStride + c ];
+            }
+        }
+    }
+}
+
+// Same as transposePixels, but row r of column c is only written where r < clipTop[ c ]
+// or r > clipBot[ c ] (rows are numbered from firstRow), so wall spans already in dst survive.
+static void transposePixelsOutsideClip( const Uint32 *src, int srcStride, Uint32 *dst, int dstStride, int rows, int cols,
+    int firstRow, const int *clipTop, const int *clipBot ) {
+    auto keep = [&]( int r, int c ) {
+        int row = firstRow + r;
+        return row < clipTop[ c ] || row > clipBot[ c ];
+        };
+
+    for (int rb = 0; rb < rows; rb += TRANSPOSE_BLOCK)
+    {
+        int rEnd = std::min( rows, rb + TRANSPOSE_BLOCK );
+        for (int cb = 0; cb < cols; cb += TRANSPOSE_BLOCK)
+        {
+            int cEnd = std::min( cols, cb + TRANSPOSE_BLOCK );
+            int r = rb;
+#if HAS_SSE2
+            for (; r + 4 <= rEnd; r += 4)
+            {
+                const __m128i rowIds = _mm_add_epi32( _mm_set1_epi32( firstRow + r ), _mm_setr_epi32( 0, 1, 2, 3 ) );
+                int c = cb;
+                for (; c + 4 <= cEnd; c += 4)
+                {
+                    __m128i t[ 4 ];
+                    transpose4x4( src + r * srcStride + c, srcStride, t[ 0 ], t[ 1 ], t[ 2 ], t[ 3 ] );
+                    for (int k = 0; k < 4; ++k)
+                    {
+                        __m128i outside = _mm_or_si128(
+                            _mm_cmpgt_epi32( _mm_set1_epi32( clipTop[ c + k ] ), rowIds ),
+                            _mm_cmpgt_epi32( rowIds, _mm_set1_epi32( clipBot[ c + k ] ) ) );
+                        int bits = _mm_movemask_ps( _mm_castsi128_ps( outside ) );
+                        if (bits == 0) continue;
+
+                        __m128i *out = (__m128i *)(dst + (c + k) * dstStride + r);
+                        if (bits != 0xF) t[ k ] = _mm_or_si128( _mm_and_si128( outside, t[ k ] ), _mm_andnot_si128( outside, _mm_loadu_si128( out ) ) );
+                        _mm_storeu_si128( out, t[ k ] );
+                    }
+                }
+                for (; c < cEnd; ++c)
+                {
+                    for (int k = 0; k < 4; ++k)
+                    {
+                        if (keep( r + k, c )) dst[ c * dstStride + r + k ] = src[ (r + k) * srcStride + c ];
+                    }
+                }
+            }
+#endif
+            for (; r < rEnd; ++r)
+            {
+                for (int c = cb; c < cEnd; ++c)
+                {
+                    if (keep( r, c )) dst[ c * dstStride + r ] = src[ r * srcStride + c ];
+                }
+            }
+        }
+    }
+}
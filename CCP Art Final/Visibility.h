@@ -0,0 +1,112 @@
+#pragma once
+#include "GameEngine.h"
+
+// Potentially visible sets. From a grid of points inside every floor tile, rays are cast in
+// all directions until they hit a wall or a closed door; every tile a ray enters, including
+// the one that stops it, can be seen from that tile. Props and boxes only reach the render
+// queue when their footprint touches a tile in the camera tile's set; wall artworks need no
+// test, since they are only drawn where a wall ray lands.
+// A ray reaches a door tile the same way whether the door is open or closed, so toggling a
+// door only changes the sets that already contain the door tile.
+
+// Marks the tiles a ray from (px, py) along (rdx, rdy) crosses, up to the first occluder
+static void castVisibilityRay( const Engine &engineContext, float px, float py, float rdx, float rdy, Uint64 *set ) {
+    const Map &map = engineContext.map;
+    int mapX = int( px ), mapY = int( py );
+    const float deltaX = (rdx == 0.0f) ? 1e30f : std::fabs( 1.0f / rdx );
+    const float deltaY = (rdy == 0.0f) ? 1e30f : std::fabs( 1.0f / rdy );
+    const int stepX = rdx < 0.0f ? -1 : 1;
+    const int stepY = rdy < 0.0f ? -1 : 1;
+    float sideX = rdx < 0.0f ? (px - mapX) * deltaX : (mapX + 1.0f - px) * deltaX;
+    float sideY = rdy < 0.0f ? (py - mapY) * deltaY : (mapY + 1.0f - py) * deltaY;
+
+    while (mapX >= 0 && mapY >= 0 && mapX < map.width && mapY < map.height)
+    {
+        const int tile = mapY * map.width + mapX;
+        set[ tile >> 6 ] |= Uint64( 1 ) << (tile & 63);
+        if (map.tiles[ tile ] != 0) break; // wall or closed door
+
+        if (sideX < sideY)
+        {
+            sideX += deltaX;
+            mapX += stepX;
+        }
+        else
+        {
+            sideY += deltaY;
+            mapY += stepY;
+        }
+    }
+}
+
+// Rebuilds the set of one tile; tiles the camera can't stand in get an empty set
+static void buildTileVisibility( Engine &engineContext, int tile ) {
+    Visibility &vis = engineContext.visibility;
+    Uint64 *set = vis.sets.data() + size_t( tile ) * vis.words;
+    std::fill( set, set + vis.words, Uint64( 0 ) );
+    if (engineContext.map.tiles[ tile ] != 0) return;
+
+    // Sample points reach close to the tile edges, where the camera can stand too
+    const int tileX = tile % engineContext.map.width, tileY = tile / engineContext.map.width;
+    const float inset = 0.02f;
+    for (int sy = 0; sy < VISIBILITY_SAMPLES; ++sy)
+    {
+        for (int sx = 0; sx < VISIBILITY_SAMPLES; ++sx)
+        {
+            const float px = tileX + inset + (1.0f - 2.0f * inset) * sx / float( VISIBILITY_SAMPLES - 1 );
+            const float py = tileY + inset + (1.0f - 2.0f * inset) * sy / float( VISIBILITY_SAMPLES - 1 );
+            for (int r = 0; r < VISIBILITY_RAYS; ++r)
+            {
+                const float angle = (r + 0.5f) * (2.0f * 3.14159265f / VISIBILITY_RAYS);
+                castVisibilityRay( engineContext, px, py, std::cos( angle ), std::sin( angle ), set );
+            }
+        }
+    }
+}
+
+static void buildVisibility( Engine &engineContext ) {
+    Visibility &vis = engineContext.visibility;
+    const int tiles = engineContext.map.width * engineContext.map.height;
+    vis.words = (tiles + 63) / 64;
+    vis.sets.assign( size_t( tiles ) * vis.words, 0 );
+    for (int tile = 0; tile < tiles; ++tile) buildTileVisibility( engineContext, tile );
+}
+
+// After the door at (doorX, doorY) opened or closed: only sets that see the door can change
+static void updateVisibilityForDoor( Engine &engineContext, int doorX, int doorY ) {
+    Visibility &vis = engineContext.visibility;
+    if (vis.sets.empty()) return;
+    const int door = doorY * engineContext.map.width + doorX;
+    const int tiles = engineContext.map.width * engineContext.map.height;
+    for (int tile = 0; tile < tiles; ++tile)
+    {
+        const Uint64 *set = vis.sets.data() + size_t( tile ) * vis.words;
+        if (tile == door || (set[ door >> 6 ] >> (door & 63)) & 1) buildTileVisibility( engineContext, tile );
+    }
+}
+
+// Set of the tile at (x, y), or null when there is none (everything counts as visible)
+static const Uint64 *visibleFrom( const Engine &engineContext, float x, float y ) {
+    const Visibility &vis = engineContext.visibility;
+    const int tileX = int( std::floor( x ) ), tileY = int( std::floor( y ) );
+    if (vis.sets.empty() || tileX < 0 || tileY < 0 || tileX >= engineContext.map.width || tileY >= engineContext.map.height) return nullptr;
+    const int tile = tileY * engineContext.map.width + tileX;
+    if (engineContext.map.tiles[ tile ] != 0) return nullptr;
+    return vis.sets.data() + size_t( tile ) * vis.words;
+}
+
+// Whether any tile under the world rectangle [x0, x1] x [y0, y1] is in set
+static bool anyTileVisible( const Engine &engineContext, const Uint64 *set, float x0, float y0, float x1, float y1 ) {
+    if (!set) return true;
+    const int tx0 = std::max( 0, int( std::floor( x0 ) ) ), tx1 = std::min( engineContext.map.width - 1, int( std::floor( x1 ) ) );
+    const int ty0 = std::max( 0, int( std::floor( y0 ) ) ), ty1 = std::min( engineContext.map.height - 1, int( std::floor( y1 ) ) );
+    for (int ty = ty0; ty <= ty1; ++ty)
+    {
+        for (int tx = tx0; tx <= tx1; ++tx)
+        {
+            const int tile = ty * engineContext.map.width + tx;
+            if ((set[ tile >> 6 ] >> (tile & 63)) & 1) return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+#include <vector>
+
+// Persistent pool of render threads. submit() hands out job indices 0..count-1 to the
+// workers and returns at once; wait() lets the calling thread help with what is left
+// and returns once every job has finished. run() is submit() + wait().
+// Worker ids passed to the job are 0..threadCount()-1 (the caller is the last id),
+// so callers can keep per-worker scratch without locking.
+struct WorkerPool
+{
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    std::function<void( int, int )> job;
+    int jobCount = 0;
+    std::atomic<int> nextJob{ 0 };
+    int pending = 0;          // workers that have not finished the current batch
+    unsigned long long batch = 0;
+    bool quitting = false;
+
+    ~WorkerPool() {
+        stop();
+    }
+
+    int threadCount() const {
+        return (int)threads.size() + 1;
+    }
+
+    // threadCount <= 0 uses every hardware thread
+    void start( int threadCount ) {
+        stop();
+        if (threadCount <= 0) threadCount = (int)std::thread::hardware_concurrency();
+        threadCount = std::max( 1, threadCount );
+
+        quitting = false;
+        for (int i = 0; i < threadCount - 1; ++i)
+        {
+            threads.emplace_back( [this, i]() { workerMain( i ); } );
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard( lock );
+            quitting = true;
+        }
+        wake.notify_all();
+        for (auto &thread : threads) thread.join();
+        threads.clear();
+    }
+
+    // Only one batch may be in flight; call wait() before the next submit()
+    void submit( int count, const std::function<void( int job, int worker )> &fn ) {
+        {
+            std::lock_guard<std::mutex> guard( lock );
+            job = fn;
+            jobCount = count;
+            nextJob = 0;
+            pending = (int)threads.size();
+            ++batch;
+        }
+        wake.notify_all();
+    }
+
+    void wait() {
+        // With no threads the whole batch runs here
+        drain( (int)threads.size() );
+
+        std::unique_lock<std::mutex> guard( lock );
+        done.wait( guard, [this]() { return pending == 0; } );
+    }
+
+    void run( int count, const std::function<void( int job, int worker )> &fn ) {
+        submit( count, fn );
+        wait();
+    }
+
+    void drain( int worker ) {
+        for (int i = nextJob.fetch_add( 1 ); i < jobCount; i = nextJob.fetch_add( 1 ))
+        {
+            job( i, worker );
+        }
+    }
+
+    void workerMain( int worker ) {
+        unsigned long long seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> guard( lock );
+                wake.wait( guard, [&]() { return quitting || batch != seen; } );
+                if (quitting) return;
+                seen = batch;
+            }
+
+            drain( worker );
+
+            {
+                std::lock_guard<std::mutex> guard( lock );
+                if (--pending == 0) done.notify_all();
+            }
+        }
+    }
+};
@@ -1,6 +1,15 @@
 #include "GameEngine.h"
 #include "RendererHelpers.h"
+#include "FloorKernel.h"
+#include "Raycast.h"
+#include "Lighting.h"
+#include "Transpose.h"
 #include "PhysicsHelpers.h"
+#include "SurfaceCache.h"
+#include "RenderQueue.h"
+#include "DynamicResolution.h"
+#include "StaticFrame.h"
+#include "Benchmark.h"
 #include "MusicSystem.h"
 #include <iostream>
 #include <filesystem> 
@@ -23,11 +32,18 @@ static bool loadLevel( Engine &engineContext, const LevelDef &level ) {
 
     // Clear per-level state
     engineContext.artworks.clear();
+    engineContext.artworkFaces.clear();
+    clearSurfaceCache( engineContext );
+    invalidateFrame( engineContext );
+    engineContext.idBuffer.clear(); // ids index the old level's objects
+    engineContext.ids = nullptr;
     engineContext.artImages.clear();
     engineContext.props.clear();
     engineContext.propImages.clear();
     engineContext.quads.clear();
     engineContext.benches3D.clear();
+    engineContext.boxFaces.clear();
+    engineContext.boxTextures.clear();
 
 
     fs::path folder = level.folder;
@@ -65,8 +81,7 @@ static bool loadLevel( Engine &engineContext, const LevelDef &level ) {
     auto loadOrFallback = [&]( const fs::path &path, Image &img, Uint32 fill ) {
         if (!img.loadBMP( path.string() ))
         {
-            img.width = 64; img.height = 64;
-            img.pixels.assign( 64 * 64, fill );
+            img.fill( 64, 64, fill );
         }
         };
 
@@ -75,6 +90,15 @@ static bool loadLevel( Engine &engineContext, const LevelDef &level ) {
     engineContext.hasCeiling = engineContext.ceilTex.loadBMP( (folder / "ceiling.bmp").string() );
     (void)engineContext.doorTexture.loadBMP( (folder / "door.bmp").string() );
 
+    engineContext.wallTex.buildMips();
+    engineContext.doorTexture.buildMips();
+    engineContext.floorTex.buildMips();
+    engineContext.ceilTex.buildMips();
+
+    // Wall and door columns are drawn top to bottom, so keep their texels contiguous that way
+    engineContext.wallTex.makeColumnMajor();
+    engineContext.doorTexture.makeColumnMajor();
+
     // Props
     loadProps( (folder / "props.txt").string(), engineContext.props, engineContext.propImages, engineContext.quads );
     // Build spatial buckets for quads (by tile)
@@ -99,6 +123,7 @@ static bool loadLevel( Engine &engineContext, const LevelDef &level ) {
         if (loadArtworks( (folder / "artworks.txt").string(), engineContext.artworks ))
         {
             attachArtworksToWalls( engineContext );
+            buildArtworkFaceIndex( engineContext );
             engineContext.artImages.resize( engineContext.artworks.size() );
             for (size_t i = 0; i < engineContext.artworks.size(); ++i)
             {
@@ -118,12 +143,7 @@ static bool loadLevel( Engine &engineContext, const LevelDef &level ) {
             box.angle = 3.14159265f;
 
             // Load textures (or reuse existing images)
-            if (!box.sideTexure.loadBMP( (folder / "bench.bmp").string() ))
-            {
-                box.sideTexure.width = 64; box.sideTexure.height = 64; box.sideTexure.pixels.assign( 64 * 64, rgb( 139, 90, 43 ) );
-            }
-
-            box.legTexure = box.sideTexure; // fallback
+            box.sideTexture = loadBoxTexture( engineContext, (folder / "bench.bmp").string(), rgb( 139, 90, 43 ) );
 
 
             box.legHalf = 0.05f;
@@ -135,6 +155,12 @@ static bool loadLevel( Engine &engineContext, const LevelDef &level ) {
         }
     }
 
+    // Box geometry is static: build the world-space faces once
+    for (auto &box : engineContext.benches3D) buildBoxFaces( engineContext, box );
+
+    // What each floor tile can see, for the render queue
+    buildVisibility( engineContext );
+
     engineContext.caveMode = (level.levelId == Levels::CAVE) || (level.levelId == Levels::TRANSITION);
     engineContext.hasWallOverlay = false;
     auto tryLoad = [&]( const std::filesystem::path &p, Image &dst, bool &flag ) {
@@ -177,6 +203,16 @@ static bool loadLevel( Engine &engineContext, const LevelDef &level ) {
         }
     }
 
+    // Per-asset storage formats (formats.txt), applied before the banks copy the textures
+    TextureFormats formats;
+    loadTextureFormats( (folder / "formats.txt").string(), formats );
+    applyTextureFormats( engineContext, formats );
+
+    // Overlays folded into multiplier maps, then distance light tables and
+    // pre-shaded texture banks for this level
+    bakeOverlayMuls( engineContext );
+    buildLighting( engineContext );
+
     // Spawn & camera
     engineContext.positionX = level.spawnX;
     engineContext.positionY = level.spawnY;
@@ -188,93 +224,43 @@ static bool loadLevel( Engine &engineContext, const LevelDef &level ) {
     engineContext.yaw = level.spawnDirDeg;
 
     // Load the current levels' music track
-    playMusicTrack( folder.string(), engineContext.currentLevel);
+    if (config::useMusic) playMusicTrack( folder.string(), engineContext.currentLevel);
 
     return true;
 }
 
 
-static int pickArtworkUnderCrosshair( Engine const &engineContext ) {
-    // Cast the same ray as the center column (x = RENDER_W / 2)
-    int centerX = RENDER_W / 2;
-    float camX = 2.0f * centerX / float( RENDER_W ) - 1.0f;
+// Without the id buffer: cast the center column's ray again and test the artwork bands
+static int pickArtworkByRay( Engine const &engineContext ) {
+    // Cast the same ray as the center column (x = renderW / 2)
+    int centerX = engineContext.renderW / 2;
+    float camX = 2.0f * centerX / float( engineContext.renderW ) - 1.0f;
     float rayDirX = engineContext.directionX + engineContext.planeX * camX;
     float rayDirY = engineContext.directionY + engineContext.planeY * camX;
 
-    int mapX = int( engineContext.positionX );
-    int mapY = int( engineContext.positionY );
-    float sideDistX, sideDistY;
-    float deltaDistX = (rayDirX == 0 ? 1e30f : std::fabs( 1.0f / rayDirX ));
-    float deltaDistY = (rayDirY == 0 ? 1e30f : std::fabs( 1.0f / rayDirY ));
-    int stepX = 0;
-    int stepY = 0;
-    int side = 0;
-
-    if (rayDirX < 0)
-    {
-        stepX = -1;
-        sideDistX = (engineContext.positionX - mapX) * deltaDistX;
-    }
-    else
-    {
-        stepX = 1;
-        sideDistX = (mapX + 1.0f - engineContext.positionX) * deltaDistX;
-    }
-    if (rayDirY < 0)
-    {
-        stepY = -1;
-        sideDistY = (engineContext.positionY - mapY) * deltaDistY;
-    }
-    else
-    {
-        stepY = 1;
-        sideDistY = (mapY + 1.0f - engineContext.positionY) * deltaDistY;
-    }
-
-    int hitTile = 0;
-    while (!hitTile)
-    {
-        if (sideDistX < sideDistY)
-        {
-            sideDistX += deltaDistX; mapX += stepX; side = 0;
-        }
-        else
-        {
-            sideDistY += deltaDistY; mapY += stepY; side = 1;
-        }
-        if (mapX < 0 || mapY < 0 || mapX >= engineContext.map.width || mapY >= engineContext.map.height) return -1;
-        hitTile = engineContext.map.tiles[ mapY * engineContext.map.width + mapX ];
-    }
-    if (hitTile != 1) return -1; // only real walls host framed art
-
-    float perpWallDist = (side == 0)
-        ? ((mapX - engineContext.positionX) + (1 - stepX) * 0.5f) / (rayDirX == 0 ? 1e-6f : rayDirX)
-        : ((mapY - engineContext.positionY) + (1 - stepY) * 0.5f) / (rayDirY == 0 ? 1e-6f : rayDirY);
-    perpWallDist = std::max( std::fabs( perpWallDist ), 0.05f );
+    WallHit hit;
+    castRay( engineContext, rayDirX, rayDirY, hit );
+    if (hit.tile != 1) return -1; // only real walls host framed art
 
-    float wallX = (side == 0) ? (engineContext.positionY + perpWallDist * rayDirY)
-        : (engineContext.positionX + perpWallDist * rayDirX);
-    wallX -= std::floor( wallX );
+    const int mapX = hit.mapX;
+    const int mapY = hit.mapY;
+    const int side = hit.side;
+    const float perpWallDist = hit.perpWallDist;
+    const float wallX = hit.wallX;
 
     if (perpWallDist > 20.0f) return -1;
 
-    int lineH = int( RENDER_H / std::max( perpWallDist, 1e-3f ) );
-    int yCenter = RENDER_H / 2;
+    int lineH = int( engineContext.renderH / std::max( perpWallDist, 1e-3f ) );
+    int yCenter = engineContext.renderH / 2;
 
-    for (size_t artIndex = 0; artIndex < engineContext.artworks.size(); ++artIndex)
+    for (const ArtworkSpan &span : artworksOnFace( engineContext, mapX, mapY, side ))
     {
-        const auto &art = engineContext.artworks[ artIndex ];
-        if (!art.onWall) continue;
-        if (art.wx != mapX || art.wy != mapY || art.side != side) continue;
+        if (span.u0 > wallX) break; // sorted by u0
+        if (wallX > span.u1) continue;
+        const auto &art = engineContext.artworks[ span.artIndex ];
 
-        float u0 = std::clamp( art.uCenter - 0.5f * art.uWidth, 0.0f, 1.0f );
-        float u1 = std::clamp( art.uCenter + 0.5f * art.uWidth, 0.0f, 1.0f );
-        if (wallX < u0 || wallX > u1) continue;
-
-        int bandH = std::max( 1, int( lineH * art.vHeight ) );
-        int bandCenter = RENDER_H / 2 + int( (art.vCenter - 0.5f) * lineH );
-        int bandStart = std::clamp( bandCenter - bandH / 2, 0, RENDER_H - 1 );
-        int bandEnd = std::clamp( bandStart + bandH - 1, 0, RENDER_H - 1 );
+        int bandH, bandStart, bandEnd;
+        artworkBand( art, lineH, engineContext.renderH, bandH, bandStart, bandEnd );
 
         if (yCenter >= bandStart && yCenter <= bandEnd)
         {
@@ -284,6 +270,27 @@ static int pickArtworkUnderCrosshair( Engine const &engineContext ) {
     return -1;
 }
 
+// Object drawn at pixel (x, y) in the last frame (0 for none, or without the id buffer)
+static Uint16 objectAt( Engine const &engineContext, int x, int y ) {
+    const int renderW = engineContext.renderW, renderH = engineContext.renderH;
+    if (engineContext.idBuffer.size() != size_t( renderW ) * renderH) return 0;
+    if ((unsigned)x >= (unsigned)renderW || (unsigned)y >= (unsigned)renderH) return 0;
+    return engineContext.idBuffer[ x * renderH + y ];
+}
+
+// Artwork id under the crosshair, read from the last frame's id buffer
+static int pickArtworkUnderCrosshair( Engine const &engineContext ) {
+    const int centerX = engineContext.renderW / 2, centerY = engineContext.renderH / 2;
+    if (engineContext.idBuffer.empty()) return pickArtworkByRay( engineContext );
+
+    Uint16 id = objectAt( engineContext, centerX, centerY );
+    if (objectKind( id ) != ObjectKind::ARTWORK) return -1;
+    if (engineContext.zbuffer[ centerX ] > 20.0f) return -1; // too far to read
+
+    int index = objectIndex( id );
+    return index < (int)engineContext.artworks.size() ? engineContext.artworks[ index ].id : -1;
+}
+
 void handleLevelChange( Engine &engineContext, std::vector<LevelDef> levels, Levels desiredLevel ) {
     engineContext.currentLevel = desiredLevel;
     loadLevel( engineContext, levels[ desiredLevel ] );
@@ -352,224 +359,88 @@ void updateMusicStream() {
 }
 
 
-static void render( Engine &engineContext, float dt ) {
-    (void)dt;
-
-    auto luma = []( Uint32 c ) -> float {
-        float r = float( (c >> 16) & 255 ), g = float( (c >> 8) & 255 ), b = float( c & 255 );
-        return (0.299f * r + 0.587f * g + 0.114f * b) / 255.0f;
-        };
-
-  
-    auto mulFromOverlay = [&]( Uint32 oc, float strength, float minMul, float maxMul, float gamma = 1.0f ) -> float {
-        float L = std::pow( std::clamp( luma( oc ), 0.0f, 1.0f ), gamma );
-        float m = 1.0f - strength * (1.0f - L);               // dark pixels -> lower multiplier
-        return std::clamp( m, minMul, maxMul );
-        };
-
-    // Apply brightness multiplier to a packed ARGB8888 color (no hue shift)
-    auto applyMul = [&]( Uint32 base, float m ) -> Uint32 {
-        float rf = float( (base >> 16) & 255 ) * m;
-        float gf = float( (base >> 8) & 255 ) * m;
-        float bf = float( base & 255 ) * m;
-        Uint8 r = Uint8( std::clamp( rf, 0.0f, 255.0f ) );
-        Uint8 g = Uint8( std::clamp( gf, 0.0f, 255.0f ) );
-        Uint8 b = Uint8( std::clamp( bf, 0.0f, 255.0f ) );
-        return rgb( r, g, b );
-        };
-
-    auto shadeCol = []( Uint32 c, float s ) -> Uint32 {
-        s = std::clamp( s, 0.0f, 1.0f );
-        Uint8 r = Uint8( ((c >> 16) & 255) * s );
-        Uint8 g = Uint8( ((c >> 8) & 255) * s );
-        Uint8 b = Uint8( (c & 255) * s );
-        return rgb( r, g, b );
-        };
-
-    auto caveLight = [&]( float dist ) -> float {
-        if (!engineContext.caveMode) return 1.0f;
-        float R = engineContext.lightRadius;
-        float t = std::clamp( 1.0f - std::pow( dist / std::max( 0.001f, R ), engineContext.lightFalloff ), 0.0f, 1.0f );
-        return std::max( engineContext.caveAmbient, t );
-        };
-
-    const int half = RENDER_H / 2;
-    engineContext.zbuffer.assign( RENDER_W, 1e9f );
+// Renders walls, floor/ceiling, benches and props for columns [stripBegin, stripEnd).
+// Strips never share pixels, so any number of them can run at once.
+static void renderWorldStrip( Engine &engineContext, StripScratch &scratch, int stripBegin, int stripEnd ) {
+    const int renderW = engineContext.renderW, renderH = engineContext.renderH;
+    const int half = renderH / 2;
 
-    static int clipTop[ RENDER_W ];
-    static int clipBot[ RENDER_W ];
-    for (int i = 0; i < RENDER_W; ++i)
+    std::vector<int> &clipTop = scratch.clipTop;
+    std::vector<int> &clipBot = scratch.clipBot;
+    for (int i = stripBegin; i < stripEnd; ++i)
     {
-        clipTop[ i ] = RENDER_H;
+        clipTop[ i ] = renderH;
         clipBot[ i ] = -1;
     }
 
-	// Walls (raycasted)
-    for (int x = 0; x < RENDER_W; ++x)
+    // Nothing picked where only floor and ceiling get drawn
+    if (engineContext.ids)
     {
-        // Build ray
-        float camX = 2.0f * x / float( RENDER_W ) - 1.0f;
-        float rayDirX = engineContext.directionX + engineContext.planeX * camX;
-        float rayDirY = engineContext.directionY + engineContext.planeY * camX;
-
-        int mapX = int( engineContext.positionX );
-        int mapY = int( engineContext.positionY );
-
-        float sideDistX, sideDistY;
-        float deltaDistX = (rayDirX == 0) ? 1e30f : std::fabs( 1.0f / rayDirX );
-        float deltaDistY = (rayDirY == 0) ? 1e30f : std::fabs( 1.0f / rayDirY );
-        int stepX = 0, stepY = 0, side = 0;
-
-        if (rayDirX < 0)
-        {
-            stepX = -1; sideDistX = (engineContext.positionX - mapX) * deltaDistX;
-        }
-        else
-        {
-            stepX = 1; sideDistX = (mapX + 1.0f - engineContext.positionX) * deltaDistX;
-        }
-        if (rayDirY < 0)
-        {
-            stepY = -1; sideDistY = (engineContext.positionY - mapY) * deltaDistY;
-        }
-        else
-        {
-            stepY = 1; sideDistY = (mapY + 1.0f - engineContext.positionY) * deltaDistY;
-        }
+        std::fill( engineContext.ids + stripBegin * renderH, engineContext.ids + stripEnd * renderH, Uint16( 0 ) );
+    }
 
-        // DDA
-        int hitTile = 0;
-        while (!hitTile)
-        {
-            if (sideDistX < sideDistY)
-            {
-                sideDistX += deltaDistX; mapX += stepX; side = 0;
-            }
-            else
-            {
-                sideDistY += deltaDistY; mapY += stepY; side = 1;
-            }
+	// Walls (raycasted)
+    WallHit *hits = scratch.hits.data();
+    castColumns( engineContext, stripBegin, stripEnd, hits );
 
-            if (mapX < 0 || mapY < 0 || mapX >= engineContext.map.width || mapY >= engineContext.map.height) break;
-            int tile = engineContext.map.tiles[ mapY * engineContext.map.width + mapX ];
-            if (tile > 0) hitTile = tile;
-        }
-        if (!hitTile) continue;
+    for (int x = stripBegin; x < stripEnd; ++x)
+    {
+        const WallHit &hit = hits[ x ];
+        if (!hit.tile) continue;
 
-        // Perpendicular distance
-        float perpWallDist = (side == 0)
-            ? ((mapX - engineContext.positionX) + (1 - stepX) * 0.5f) / (rayDirX == 0 ? 1e-6f : rayDirX)
-            : ((mapY - engineContext.positionY) + (1 - stepY) * 0.5f) / (rayDirY == 0 ? 1e-6f : rayDirY);
-        perpWallDist = std::max( std::fabs( perpWallDist ), 0.05f );
+        const int hitTile = hit.tile;
+        const int side = hit.side;
+        const int mapX = hit.mapX;
+        const int mapY = hit.mapY;
+        const float perpWallDist = hit.perpWallDist;
+        const float wallX = hit.wallX;
 
         // Column geometry
-        int lineH = int( RENDER_H / std::max( perpWallDist, 1e-3f ) );
+        int lineH = int( renderH / std::max( perpWallDist, 1e-3f ) );
         int drawStart = std::max( 0, -lineH / 2 + half );
-        int drawEnd = std::min( RENDER_H - 1, lineH / 2 + half );
+        int drawEnd = std::min( renderH - 1, lineH / 2 + half );
         clipTop[ x ] = std::min( clipTop[ x ], drawStart );
         clipBot[ x ] = std::max( clipBot[ x ], drawEnd );
-        // Wall X coordinate (for texture)
-        float wallX = (side == 0)
-            ? (engineContext.positionY + perpWallDist * rayDirY)
-            : (engineContext.positionX + perpWallDist * rayDirX);
-        wallX -= std::floor( wallX );
 
         // Texture selection
-        const Image &wallTexture = (hitTile == 2) ? engineContext.doorTexture : engineContext.wallTex;
+        const LightBanks &wallBanks = (hitTile == 2) ? engineContext.doorBanks : engineContext.wallBanks;
+
+        // Faces with artworks draw from the surface cache once baked
+        const Surface *surface = (hitTile == 1) ? findSurface( engineContext, scratch, mapX, mapY, side ) : nullptr;
 
         // Draw wall column (uses fixed-step in RendererHelpers)
-        drawTexturedColumn( engineContext, wallTexture, x, drawStart, drawEnd, perpWallDist, wallX );
+        if (surface)
+        {
+            drawSurfaceColumn( engineContext, *surface, x, drawStart, drawEnd, perpWallDist, wallX );
+        }
+        else
+        {
+            drawTexturedColumn( engineContext, wallBanks, x, drawStart, drawEnd, perpWallDist, wallX );
+        }
 
-        if (hitTile == 1)
+        if (hitTile == 1 && !surface)
         {
             if (engineContext.currentLevel == Levels::MUSEUM) {
-                for (size_t artIndex = 0; artIndex < engineContext.artworks.size(); ++artIndex)
+                for (const ArtworkSpan& span : artworksOnFace(engineContext, mapX, mapY, side))
                 {
-                    const auto& art = engineContext.artworks[artIndex];
-                    if (!art.onWall) continue;
-                    if (art.wx != mapX || art.wy != mapY || art.side != side) continue;
-
-                    float u0 = std::clamp(art.uCenter - art.uWidth * 0.5f, 0.0f, 1.0f);
-                    float u1 = std::clamp(art.uCenter + art.uWidth * 0.5f, 0.0f, 1.0f);
-                    if (wallX < u0 || wallX > u1) continue;
-
-                    const Image& texture = engineContext.artImages[artIndex];
+                    if (span.u0 > wallX) break; // sorted by u0
+                    if (wallX > span.u1) continue;
 
-                    // Frame/mat proportions
-                    const float FRAME_U = 0.08f, FRAME_V = 0.08f;
-                    const float MAT_U = 0.03f, MAT_V = 0.04f;
+                    const auto& art = engineContext.artworks[span.artIndex];
+                    const float u0 = span.u0, u1 = span.u1;
 
-                    const Uint32 goldLight = rgb(235, 200, 80);
-                    const Uint32 goldMid = rgb(212, 175, 55);
-                    const Uint32 goldDark = rgb(160, 130, 40);
-                    const Uint32 matCol = rgb(235, 235, 220);
+                    const Image& artImage = engineContext.artImages[span.artIndex];
 
                     float uLocal = (wallX - u0) / std::max(0.0001f, (u1 - u0));
 
-                    int bandH = std::max(1, int(lineH * art.vHeight));
-                    int bandCenter = RENDER_H / 2 + int((art.vCenter - 0.5f) * lineH);
-                    int bandStart = std::clamp(bandCenter - bandH / 2, 0, RENDER_H - 1);
-                    int bandEnd = std::clamp(bandStart + bandH - 1, 0, RENDER_H - 1);
-
-                    float uLeftFrameEdge = FRAME_U;
-                    float uRightFrameEdge = 1.0f - FRAME_U;
-                    float uLeftMatEdge = FRAME_U + MAT_U;
-                    float uRightMatEdge = 1.0f - (FRAME_U + MAT_U);
+                    int bandH, bandStart, bandEnd;
+                    artworkBand(art, lineH, renderH, bandH, bandStart, bandEnd);
+                    const Image& texture = artImage.levelFor(artImage.height / float(bandH));
 
                     for (int y = bandStart; y <= bandEnd; ++y)
                     {
                         float vLocal = (y - bandStart) / float(std::max(1, bandH - 1));
-                        float vTopFrameEdge = FRAME_V;
-                        float vBottomFrameEdge = 1.0f - FRAME_V;
-                        float vTopMatEdge = FRAME_V + MAT_V;
-                        float vBottomMatEdge = 1.0f - (FRAME_V + MAT_V);
-
-                        Uint32 color;
-
-                        bool inFrame =
-                            (uLocal < uLeftFrameEdge) || (uLocal > uRightFrameEdge) ||
-                            (vLocal < vTopFrameEdge) || (vLocal > vBottomFrameEdge);
-
-                        if (inFrame)
-                        {
-                            bool topOrLeft = (vLocal < vTopFrameEdge + 0.02f) || (uLocal < uLeftFrameEdge + 0.02f);
-                            bool bottomOrRight = (vLocal > vBottomFrameEdge - 0.02f) || (uLocal > uRightFrameEdge - 0.02f);
-                            color = goldMid;
-                            if (topOrLeft)
-                            {
-                                color = goldLight;
-                            }
-                            else if (bottomOrRight)
-                            {
-                                color = goldDark;
-                            }
-                        }
-                        else
-                        {
-                            bool inMat =
-                                (uLocal < uLeftMatEdge) || (uLocal > uRightMatEdge) ||
-                                (vLocal < vTopMatEdge) || (vLocal > vBottomMatEdge);
-
-                            if (inMat)
-                            {
-                                color = matCol;
-                            }
-                            else
-                            {
-                                float innerU0 = uLeftMatEdge, innerU1 = uRightMatEdge;
-                                float innerV0 = vTopMatEdge, innerV1 = vBottomMatEdge;
-                                float un = (uLocal - innerU0) / std::max(0.0001f, (innerU1 - innerU0));
-                                float vn = (vLocal - innerV0) / std::max(0.0001f, (innerV1 - innerV0));
-                                int texX = std::clamp(int(un * (texture.width - 1)), 0, texture.width - 1);
-                                int texY = std::clamp(int(vn * (texture.height - 1)), 0, texture.height - 1);
-                                color = texture.sample(texX, texY);
-
-                                // magenta transparent -> mat
-                                if (((color >> 16) & 255) == 255 && ((color >> 8) & 255) == 0 && (color & 255) == 255)
-                                    color = matCol;
-                            }
-                        }
-                        putPix(engineContext, x, y, color);
+                        putPix(engineContext, x, y, artworkTexel(texture, uLocal, vLocal));
                     }
                 }
             }
@@ -578,6 +449,26 @@ static void render( Engine &engineContext, float dt ) {
             }
         }
 
+        // Doors and artworks can be picked
+        if (engineContext.ids)
+        {
+            if (hitTile == 2)
+            {
+                putIdSpan( engineContext, x, drawStart, drawEnd, objectId( ObjectKind::DOOR, mapY * engineContext.map.width + mapX ) );
+            }
+            else if (hitTile == 1)
+            {
+                for (const ArtworkSpan &span : artworksOnFace( engineContext, mapX, mapY, side ))
+                {
+                    if (span.u0 > wallX) break;
+                    if (wallX > span.u1) continue;
+                    int bandH, bandStart, bandEnd;
+                    artworkBand( engineContext.artworks[ span.artIndex ], lineH, renderH, bandH, bandStart, bandEnd );
+                    putIdSpan( engineContext, x, bandStart, bandEnd, objectId( ObjectKind::ARTWORK, span.artIndex ) );
+                }
+            }
+        }
+
         // Fill zbuffer for sprites/floor/ceiling occlusion
         engineContext.zbuffer[ x ] = perpWallDist;
     }
@@ -588,9 +479,20 @@ static void render( Engine &engineContext, float dt ) {
     float rayDirX1 = engineContext.directionX + engineContext.planeX;
     float rayDirY1 = engineContext.directionY + engineContext.planeY;
 
-    const float posZ = 0.5f * RENDER_H;
+    const float posZ = 0.5f * renderH;
+
+    // Rows with nothing but a shaded texture go through the fixed-point span kernel;
+    // overlay multipliers and decals still need the per-pixel path below
+    const bool floorKernel = engineContext.hasFloor && engineContext.quads.empty() && !engineContext.hasFloorMul;
+    const Engine::GrayTex *floorMul = engineContext.hasFloorMul ? &engineContext.floorMul : nullptr;
+    const bool ceilingKernel = engineContext.hasCeiling;
 
-    for (int y = 0; y < RENDER_H; ++y)
+    // With a column-major target the kernel fills a row-major strip tile instead, which
+    // is transposed into the target's columns once all rows are done
+    const bool columnTarget = engineContext.targetStepY == 1;
+    const int stripW = stripEnd - stripBegin;
+
+    for (int y = 0; y < renderH; ++y)
     {
         const int prop = y - half;
         if (prop == 0) continue;
@@ -598,12 +500,36 @@ static void render( Engine &engineContext, float dt ) {
         float rowDist = std::fabs( posZ / float( prop ) );
 
         // Step across row
-        float stepX = rowDist * (rayDirX1 - rayDirX0) / float( RENDER_W );
-        float stepY = rowDist * (rayDirY1 - rayDirY0) / float( RENDER_W );
-        float worldX = engineContext.positionX + rowDist * rayDirX0;
-        float worldY = engineContext.positionY + rowDist * rayDirY0;
+        float stepX = rowDist * (rayDirX1 - rayDirX0) / float( renderW );
+        float stepY = rowDist * (rayDirY1 - rayDirY0) / float( renderW );
+        float worldX = engineContext.positionX + rowDist * rayDirX0 + stepX * stripBegin;
+        float worldY = engineContext.positionY + rowDist * rayDirY0 + stepY * stripBegin;
+
+        // World units per pixel across the row; a texture spans one tile
+        const float rowStep = std::sqrt( stepX * stepX + stepY * stepY );
+
+        if (y >= half ? floorKernel : ceilingKernel)
+        {
+            const LightBanks &banks = (y >= half) ? engineContext.floorBanks : engineContext.ceilBanks;
+            const int level = (y >= half) ? engineContext.floorLight.levelAt( rowDist ) : engineContext.ceilLight.levelAt( rowDist );
+            const Image &bank = banks.at( level );
+            const Image &texture = bank.levelFor( rowStep * bank.width );
+            Uint32 *out = columnTarget ? &scratch.floorTile[ y * RENDER_STRIP_W ] : &targetPixel( engineContext, stripBegin, y );
+            drawFloorSpan( texture, banks.palette( level ), out, clipTop.data(), clipBot.data(), y,
+                stripBegin, stripEnd, toFixed16( worldX ), toFixed16( worldY ), toFixed16( stepX ), toFixed16( stepY ), 256 );
+            continue;
+        }
 
-        for (int x = 0; x < RENDER_W; ++x)
+        // Light is constant along the row
+        const int floorLevel = engineContext.floorLight.levelAt( rowDist );
+        const int ceilLevel = engineContext.ceilLight.levelAt( rowDist );
+        const Image &floorBank = engineContext.floorBanks.at( floorLevel ).levelFor( rowStep * engineContext.floorTex.width );
+        const Image &ceilBank = engineContext.ceilBanks.at( ceilLevel ).levelFor( rowStep * engineContext.ceilTex.width );
+        const Uint32 *floorColors = engineContext.floorBanks.palette( floorLevel );
+        const Uint32 *ceilColors = engineContext.ceilBanks.palette( ceilLevel );
+        const float torch = lightLevelShade( engineContext.torchLight.levelAt( rowDist ) );
+
+        for (int x = stripBegin; x < stripEnd; ++x)
         {
             float fx = worldX - std::floor( worldX );
             float fy = worldY - std::floor( worldY );
@@ -618,43 +544,24 @@ static void render( Engine &engineContext, float dt ) {
             {
                 if (engineContext.hasFloor)
                 {
-                    int tx = int( fx * engineContext.floorTex.width );
-                    int ty = int( fy * engineContext.floorTex.height );
-                    Uint32 color = engineContext.floorTex.sample( tx, ty );
-
-                    float m = 1.0f;
+                    int tx = int( fx * floorBank.width );
+                    int ty = int( fy * floorBank.height );
+                    Uint32 color = floorBank.sample( tx, ty, floorColors );
 
-                    if (engineContext.hasFloorStains)
-                    {
-                        int ox = int( fx * engineContext.floorOverlayStains.width ) % engineContext.floorOverlayStains.width;
-                        int oy = int( fy * engineContext.floorOverlayStains.height ) % engineContext.floorOverlayStains.height;
-                        Uint32 oc = engineContext.floorOverlayStains.sample( ox, oy );
-                        m *= mulFromOverlay( oc, /*strength*/0.45f, /*min*/0.80f, /*max*/1.03f, /*gamma*/1.2f );
-                    }
-                    if (engineContext.hasFloorCracks)
-                    {
-                        int ox = int( fx * engineContext.floorOverlayCracks.width ) % engineContext.floorOverlayCracks.width;
-                        int oy = int( fy * engineContext.floorOverlayCracks.height ) % engineContext.floorOverlayCracks.height;
-                        Uint32 oc = engineContext.floorOverlayCracks.sample( ox, oy );
-                        m *= mulFromOverlay( oc, /*strength*/0.85f, /*min*/0.55f, /*max*/1.00f, /*gamma*/1.6f );
-                    }
-                    if (engineContext.hasFloorPuddles)
+                    // Baked cracks/stains/puddles multiplier
+                    if (floorMul)
                     {
-                        int ox = int( fx * engineContext.floorOverlayPuddles.width ) % engineContext.floorOverlayPuddles.width;
-                        int oy = int( fy * engineContext.floorOverlayPuddles.height ) % engineContext.floorOverlayPuddles.height;
-                        Uint32 oc = engineContext.floorOverlayPuddles.sample( ox, oy );
-                        m *= mulFromOverlay( oc, /*strength*/0.60f, /*min*/0.70f, /*max*/1.02f, /*gamma*/1.1f );
+                        int mx = int( fx * floorMul->width );
+                        int my = int( fy * floorMul->height );
+                        mx = std::min( mx, floorMul->width - 1 );
+                        my = std::min( my, floorMul->height - 1 );
+                        color = colorMul( color, byteToMul88( floorMul->data[ my * floorMul->width + mx ] ) );
                     }
-
-                    color = applyMul( color, m );
-
-                    float shade = std::clamp( 1.0f / (0.02f * rowDist), 0.30f, 1.0f );
-                    shade *= caveLight( rowDist );  // keep your cave torch falloff
-                    putPix( engineContext, x, y, shadeCol( color, shade ) );
+                    putPix( engineContext, x, y, color );
 
                     if (rowDist < engineContext.zbuffer[ x ] && !engineContext.quadBuckets.empty())
                     {
-                        if (shade >= 0.06f) // skip work when very dark
+                        if (lightLevelShade( floorLevel ) >= 0.06f) // skip work when very dark
                         {
                             int txTile = (int)std::floor( worldX );
                             int tyTile = (int)std::floor( worldY );
@@ -667,20 +574,22 @@ static void render( Engine &engineContext, float dt ) {
                                     float u, v;
                                     if (!quadprop_local_uv( q, worldX, worldY, u, v )) continue;
 
-                                    Uint32 dc = sample_bilinear_uv_keyed( q.texture, u, v );
-                                    // magenta keyed; ignore transparent
-                                    if (((dc >> 16) & 255) == 255 && ((dc >> 8) & 255) == 0 && (dc & 255) == 255) continue;
+                                    Uint32 dc = sample_bilinear_uv( q.texture, u, v );
+                                    // ignore transparent
+                                    const int coverage = int( dc >> 24 );
+                                    if (coverage == 0) continue;
 
                                     // Treat quad as neutral detail: compute multiplier from its luminance
-                                    float mul = mulFromOverlay( dc, /*strength*/1.00f, /*min*/0.55f, /*max*/1.05f, /*gamma*/1.4f );
+                                    float mul = overlayMul( colorUnpremultiply( dc ), /*strength*/1.00f, /*min*/0.55f, /*max*/1.05f, /*gamma*/1.4f );
                                     // Incorporate decal AO & cave light (as darkening influence)
                                     float ao = std::clamp( q.AOMultiplier, 0.5f, 1.0f );
-                                    float l = caveLight( rowDist );
-                                    float finalMul = std::clamp( mul * (0.9f + 0.1f * ao) * l, 0.0f, 1.05f );
+                                    float finalMul = std::clamp( mul * (0.9f + 0.1f * ao) * torch, 0.0f, 1.05f );
+                                    // Partly covered edge texels fade toward no change
+                                    finalMul = 1.0f + (finalMul - 1.0f) * (coverage / 255.0f);
 
                                     // Multiply the pixel already written in backbuffer
-                                    Uint32 under = engineContext.backbuffer[ y * RENDER_W + x ];
-                                    putPix( engineContext, x, y, applyMul( under, finalMul ) );
+                                    Uint32 under = targetPixel( engineContext, x, y );
+                                    putPix( engineContext, x, y, colorMul( under, toMul88( finalMul ) ) );
                                 }
                             }
                         }
@@ -703,13 +612,9 @@ static void render( Engine &engineContext, float dt ) {
                 // Ceiling
                 if (engineContext.hasCeiling)
                 {
-                    int tx = int( fx * engineContext.ceilTex.width );
-                    int ty = int( fy * engineContext.ceilTex.height );
-                    Uint32 color = engineContext.ceilTex.sample( tx, ty );
-                    float shade = std::clamp( 1.0f / (0.02f * rowDist), 0.35f, 1.0f );
-                    shade *= caveLight( rowDist );             
-
-                    putPix( engineContext, x, y, shadeCol( color, shade ) );
+                    int tx = int( fx * ceilBank.width );
+                    int ty = int( fy * ceilBank.height );
+                    putPix( engineContext, x, y, ceilBank.sample( tx, ty, ceilColors ) );
                 }
                 else
                 {
@@ -722,36 +627,44 @@ static void render( Engine &engineContext, float dt ) {
         }
     }
 
-    // 3D benches
-    if (engineContext.benches3D.size() > 0)
+    if (columnTarget)
     {
-        for (const auto &box : engineContext.benches3D)
-        {
-            render_box( engineContext, box );
-            render_legs( engineContext, box );
-            // render_box_top( engineContext, box, (box.sideTexure.width > 0 ? box.sideTexure : engineContext.floorTex) );
-        }
+        auto flushTile = [&]( int rowBegin, int rowEnd ) {
+            transposePixelsOutsideClip( &scratch.floorTile[ rowBegin * RENDER_STRIP_W ], RENDER_STRIP_W,
+                &targetPixel( engineContext, stripBegin, rowBegin ), renderH, rowEnd - rowBegin, stripW,
+                rowBegin, clipTop.data() + stripBegin, clipBot.data() + stripBegin );
+            };
+        if (ceilingKernel) flushTile( 0, half );
+        if (floorKernel) flushTile( half + 1, renderH );
     }
 
-
-	// Props (billboarded)
-    for (size_t i = 0; i < engineContext.props.size(); ++i)
+    // Props and 3D benches, far to near (queue built in beginRender)
+    for (const RenderItem &item : engineContext.renderQueue)
     {
-        const auto &prop = engineContext.props[ i ];
-        const auto &texture = engineContext.propImages[ prop.textureID ];
+        if (item.x1 < stripBegin || item.x0 >= stripEnd) continue;
+        if (hiddenBehindWalls( engineContext, item, std::max( item.x0, stripBegin ), std::min( item.x1, stripEnd - 1 ) )) continue;
 
-        // Camera space
-        float dx = prop.x - engineContext.positionX, dy = prop.y - engineContext.positionY;
-        float invDet = 1.0f / (engineContext.planeX * engineContext.directionY - engineContext.directionX * engineContext.planeY);
-        float transX = invDet * (engineContext.directionY * dx - engineContext.directionX * dy);
-        float transY = invDet * (-engineContext.planeY * dx + engineContext.planeX * dy);
-        if (transY <= 0) continue;
+        if (item.kind == RenderKind::BOX)
+        {
+            const auto &box = engineContext.benches3D[ item.index ];
+            const Uint16 id = objectId( ObjectKind::BOX, item.index );
+            render_box( engineContext, box, stripBegin, stripEnd, id );
+            render_box_top( engineContext, box, engineContext.boxTextures[ box.sideTexture ], stripBegin, stripEnd, id );
+            continue;
+        }
 
-        int spriteScreenX = int( (RENDER_W / 2) * (1 + transX / transY) );
-        float baseH = (RENDER_H / transY);
+        // Billboarded prop, in camera space
+        const auto &prop = engineContext.props[ item.index ];
+        const auto &propImage = engineContext.propImages[ prop.textureID ];
+        const float transX = item.camX;
+        const float transY = item.camY;
+
+        int spriteScreenX = int( (renderW / 2) * (1 + transX / transY) );
+        float baseH = (renderH / transY);
         int spriteH = std::max( 1, int( std::fabs( baseH * prop.scale ) ) );
         int spriteW = spriteH;
-        int bottomY = int( RENDER_H * 0.5f + baseH * 0.5f );
+        const Image &texture = propImage.levelFor( propImage.height / float( spriteH ) );
+        int bottomY = int( renderH * 0.5f + baseH * 0.5f );
 
         int y0 = bottomY - spriteH;
         int y1 = bottomY - 1;
@@ -759,42 +672,50 @@ static void render( Engine &engineContext, float dt ) {
         int x1 = spriteW / 2 + spriteScreenX - 1;
 
         int cy0 = std::max( 0, y0 );
-        int cy1 = std::min( RENDER_H - 1, y1 );
-        int cx0 = std::max( 0, x0 );
-        int cx1 = std::min( RENDER_W - 1, x1 );
+        int cy1 = std::min( renderH - 1, y1 );
+        int cx0 = std::max( stripBegin, x0 );
+        int cx1 = std::min( stripEnd - 1, x1 );
         if (cy0 > cy1 || cx0 > cx1) continue;
 
-        float invSpriteH = 1.0f / std::max( 1, spriteH );
         float invSpriteW = 1.0f / std::max( 1, spriteW );
+        const Uint16 id = objectId( ObjectKind::PROP, item.index );
 
-        for (int sx = cx0; sx <= cx1; ++sx)
-        {
-            if (!(transY > 0 && transY < engineContext.zbuffer[ sx ])) continue;
-
-            float u = float( sx - x0 ) * invSpriteW;
-            int texX = std::clamp( int( u * texture.width ), 0, texture.width - 1 );
+        // Texture v in 16.16, stepped once per screen row
+        const Sint64 vStep = std::max<Sint64>( 1, (Sint64( texture.height ) << 16) / spriteH );
+        const TexelRun wholeColumn = { 0, Uint16( texture.height ) };
 
-            for (int sy = cy0; sy <= cy1; ++sy)
+        texture.withFetch( [&]( auto fetch ) {
+            for (int sx = cx0; sx <= cx1; ++sx)
             {
-                float v = float( sy - y0 ) * invSpriteH;
-                int texY = std::clamp( int( v * texture.height ), 0, texture.height - 1 );
+                if (!(transY > 0 && transY < engineContext.zbuffer[ sx ])) continue;
 
-                Uint32 color = texture.sample( texX, texY );
-                if (!isNearMagenta( color, 120 ))
+                float u = float( sx - x0 ) * invSpriteW;
+                int texX = std::clamp( int( u * texture.width ), 0, texture.width - 1 );
+                const size_t column = texture.columnStart( texX );
+
+                // Only the covered runs of this texture column; images without runs are one run
+                const bool hasRuns = !texture.columnRuns.empty();
+                const TexelRun *run = hasRuns ? texture.runs.data() + texture.columnRuns[ texX ] : &wholeColumn;
+                const TexelRun *runEnd = hasRuns ? texture.runs.data() + texture.columnRuns[ texX + 1 ] : &wholeColumn + 1;
+                for (; run != runEnd; ++run)
                 {
-                    putPix( engineContext, sx, sy, color );
+                    // Screen rows whose texel row falls in [begin, end)
+                    int syBegin = y0 + int( ((Sint64( run->begin ) << 16) + vStep - 1) / vStep );
+                    int syEnd = y0 + int( ((Sint64( run->end ) << 16) + vStep - 1) / vStep );
+                    syBegin = std::max( syBegin, cy0 );
+                    syEnd = std::min( syEnd, cy1 + 1 );
+
+                    Sint64 v = Sint64( syBegin - y0 ) * vStep;
+                    for (int sy = syBegin; sy < syEnd; ++sy, v += vStep)
+                    {
+                        int texY = std::min( int( v >> 16 ), texture.height - 1 );
+                        Uint32 color = texture.columnMajor ? fetch( column + texY ) : texture.sample( texX, texY );
+                        blendPix( engineContext, sx, sy, color, int( color >> 24 ) );
+                        if ((color >> 24) >= 128) putId( engineContext, sx, sy, id );
+                    }
                 }
             }
-        }
-    }
-
-    if (engineContext.benches3D.size() > 0)
-    {
-        for (const auto &box : engineContext.benches3D)
-        {
-            render_box( engineContext, box );
-            render_legs( engineContext, box );
-        }
+            } );
     }
 
 
@@ -871,8 +792,8 @@ static void render( Engine &engineContext, float dt ) {
 
         int cy0 = std::max( 0, y0 );
         int cy1 = std::min( RENDER_H - 1, y1 );
-        int cx0 = std::max( 0, x0 );
-        int cx1 = std::min( RENDER_W - 1, x1 );
+        int cx0 = std::max( stripBegin, x0 );
+        int cx1 = std::min( stripEnd - 1, x1 );
         if (cy0 > cy1 || cx0 > cx1) continue;
 
         float invSpriteH = 1.0f / std::max( 1, spriteH );
@@ -894,16 +815,116 @@ static void render( Engine &engineContext, float dt ) {
                 if (!boolIsNearBlack( color, 120 )) // Use existing transparency check
                 {
                     // Apply cave lighting / distance fog
-                    float shade = caveLight( transY );
-                    color = shadeCol( color, shade );
+                    float shade = lightLevelShade( engineContext.torchLight.levelAt( transY ) );
+                    color = colorMul( color, toShade88( shade ) );
                     putPix( engineContext, sx, sy, color );
                 }
             }
         }
     }
     */
+}
 
 
+// Starts the world pass on the worker pool and returns without waiting for it, so the
+// caller can present the previous frame meanwhile. finishRender() completes the frame.
+static void beginRender( Engine &engineContext, float dt ) {
+    (void)dt;
+
+    // Size for this frame from the last world pass time
+    updateResolution( engineContext );
+    const int renderW = engineContext.renderW, renderH = engineContext.renderH;
+    const bool scaled = renderW != RENDER_W || renderH != RENDER_H;
+    engineContext.zbuffer.assign( renderW, 1e9f );
+
+    // Bake faces that missed the surface cache last frame (workers are idle here)
+    updateSurfaceCache( engineContext );
+
+    // Timed from here, since bakes don't depend on the render size
+    engineContext.resolution.passStart = std::chrono::steady_clock::now();
+
+    // Visible props and boxes, sorted for the strips to draw
+    buildRenderQueue( engineContext );
+
+    // Object ids, written alongside the target
+    if (config::objectIdBuffer)
+    {
+        engineContext.idBuffer.resize( renderW * renderH );
+        engineContext.ids = engineContext.idBuffer.data();
+    }
+    else
+    {
+        engineContext.idBuffer.clear();
+        engineContext.ids = nullptr;
+    }
+
+    // World render target; scaled down, rows go to worldFrame and are stretched later
+    if (config::columnMajorTarget)
+    {
+        engineContext.columnFrame.resize( renderW * renderH );
+        engineContext.target = engineContext.columnFrame.data();
+        engineContext.targetStepX = renderH;
+        engineContext.targetStepY = 1;
+    }
+    else if (scaled)
+    {
+        engineContext.worldFrame.resize( renderW * renderH );
+        engineContext.target = engineContext.worldFrame.data();
+        engineContext.targetStepX = 1;
+        engineContext.targetStepY = renderW;
+    }
+    else
+    {
+        engineContext.target = engineContext.backbuffer.data();
+        engineContext.targetStepX = 1;
+        engineContext.targetStepY = RENDER_W;
+    }
+    engineContext.targetW = renderW;
+    engineContext.targetH = renderH;
+
+    // World pass: fixed-width column strips spread over the worker pool. Strip bounds
+    // don't depend on the thread count, so the frame is identical however it is split.
+    const int stripCount = (renderW + RENDER_STRIP_W - 1) / RENDER_STRIP_W;
+    engineContext.resolution.stripsLeft = stripCount;
+    engineContext.workers.submit( stripCount, [&engineContext, renderW]( int strip, int worker ) {
+        int stripBegin = strip * RENDER_STRIP_W;
+        int stripEnd = std::min( renderW, stripBegin + RENDER_STRIP_W );
+        renderWorldStrip( engineContext, engineContext.stripScratch[ worker ], stripBegin, stripEnd );
+        if (--engineContext.resolution.stripsLeft == 0) engineContext.resolution.passEnd = std::chrono::steady_clock::now();
+        } );
+}
+
+static void finishRender( Engine &engineContext ) {
+    engineContext.workers.wait();
+
+    const int renderW = engineContext.renderW, renderH = engineContext.renderH;
+    const bool scaled = renderW != RENDER_W || renderH != RENDER_H;
+
+    // Column-major world: transpose back into rows, a strip per job
+    if (engineContext.targetStepY == 1)
+    {
+        if (scaled) engineContext.worldFrame.resize( renderW * renderH );
+        Uint32 *rows = scaled ? engineContext.worldFrame.data() : engineContext.backbuffer.data();
+        const int rowStride = scaled ? renderW : RENDER_W;
+        const int stripCount = (renderW + RENDER_STRIP_W - 1) / RENDER_STRIP_W;
+        engineContext.workers.run( stripCount, [&engineContext, rows, rowStride, renderW, renderH]( int strip, int ) {
+            int stripBegin = strip * RENDER_STRIP_W;
+            int stripEnd = std::min( renderW, stripBegin + RENDER_STRIP_W );
+            transposePixels( &engineContext.columnFrame[ stripBegin * renderH ], renderH,
+                rows + stripBegin, rowStride, stripEnd - stripBegin, renderH );
+            } );
+    }
+
+    // Stretch a scaled-down world to the full frame
+    if (scaled) upscaleWorld( engineContext );
+
+    engineContext.target = engineContext.backbuffer.data();
+    engineContext.targetStepX = 1;
+    engineContext.targetStepY = RENDER_W;
+    engineContext.targetW = RENDER_W;
+    engineContext.targetH = RENDER_H;
+
+    // UI (serial, drawn over the finished world)
     int lookingAtArt = pickArtworkUnderCrosshair( engineContext );
 
     if (lookingAtArt != -1 && engineContext.placardOpen == false && engineContext.journalOpen == false)
@@ -1013,12 +1034,89 @@ static void render( Engine &engineContext, float dt ) {
 }
 
 
+// Upload and scale a finished frame to the window (nearest-neighbor scale)
+static void presentFrame( Engine &engineContext, const std::vector<Uint32> &frame ) {
+    if (!engineContext.renderer) return; // headless
+    SDL_UpdateTexture( engineContext.backtexure, nullptr, frame.data(), RENDER_W * 4 );
+    SDL_RenderClear( engineContext.renderer );
+    SDL_RenderTexture( engineContext.renderer, engineContext.backtexure, nullptr, nullptr );
+    SDL_RenderPresent( engineContext.renderer );
+}
+
+// Render one frame through the present pipeline. With depth D, up to D-1 finished frames
+// wait in presentQueue and the oldest is presented while the new one rasterizes.
+static void renderAndPresent( Engine &engineContext, float dt ) {
+    const int depth = std::max( 1, config::pipelineDepth );
+
+    beginRender( engineContext, dt );
+
+    // Overlaps the world pass running on the workers
+    if (!engineContext.presentQueue.empty() && (int)engineContext.presentQueue.size() >= depth - 1)
+    {
+        presentFrame( engineContext, engineContext.presentQueue.front() );
+        engineContext.spareFrames.push_back( std::move( engineContext.presentQueue.front() ) );
+        engineContext.presentQueue.pop_front();
+    }
+
+    finishRender( engineContext );
+
+    if (depth == 1)
+    {
+        presentFrame( engineContext, engineContext.backbuffer );
+        return;
+    }
+
+    // Queue the finished frame and continue in a free buffer
+    engineContext.presentQueue.push_back( std::move( engineContext.backbuffer ) );
+    if (!engineContext.spareFrames.empty())
+    {
+        engineContext.backbuffer = std::move( engineContext.spareFrames.back() );
+        engineContext.spareFrames.pop_back();
+    }
+    else
+    {
+        engineContext.backbuffer.assign( RENDER_W * RENDER_H, 0 );
+    }
+}
+
+// Present the frames still queued, so the window shows the last one rendered
+static void flushPresentQueue( Engine &engineContext ) {
+    while (!engineContext.presentQueue.empty())
+    {
+        presentFrame( engineContext, engineContext.presentQueue.front() );
+        engineContext.spareFrames.push_back( std::move( engineContext.presentQueue.front() ) );
+        engineContext.presentQueue.pop_front();
+    }
+}
+
+// The frame renderAndPresent just finished, presented or still queued
+static const std::vector<Uint32> &lastRenderedFrame( const Engine &engineContext ) {
+    return engineContext.presentQueue.empty() ? engineContext.backbuffer : engineContext.presentQueue.back();
+}
+
+
 
 
 
 int main( int argc, char **argv ) {
-    (void)argc; (void)argv;
-    if (!SDL_Init( SDL_INIT_VIDEO ))
+    LaunchOptions options;
+    if (!parseLaunchOptions( argc, argv, options )) return 1;
+    const bool replaying = !options.replayPath.empty();
+    const bool benchmarking = replaying || options.headless;
+    if (replaying || !options.recordPath.empty()) config::dynamicResolution = false;
+    if (benchmarking)
+    {
+        config::idleWhenStatic = false;
+        config::useMusic = false;
+    }
+
+    std::ofstream record;
+    std::ifstream replay;
+    if (!options.recordPath.empty() && !openRecording( record, options.recordPath )) return 1;
+    if (replaying && !openReplay( replay, options.replayPath )) return 1;
+    if (!options.dumpDir.empty()) std::filesystem::create_directories( options.dumpDir );
+
+    if (!SDL_Init( options.headless ? SDL_INIT_EVENTS : SDL_INIT_VIDEO ))
     {
         std::fprintf( stderr, "SDL_Init failed: %s\n", SDL_GetError() );
         return 1;
@@ -1026,22 +1124,35 @@ int main( int argc, char **argv ) {
 
     Engine engineContext;
     engineContext.backbuffer.resize( RENDER_W * RENDER_H );
-    engineContext.window = SDL_CreateWindow( "Micro Museum", RENDER_W * WIN_SCALE, RENDER_H * WIN_SCALE, 0 );
-    SDL_SetWindowPosition( engineContext.window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED );
-
-    if (!engineContext.window)
+    if (!options.headless)
     {
-        std::fprintf( stderr, "SDL_CreateWindow: %s\n", SDL_GetError() ); return 1;
+        engineContext.window = SDL_CreateWindow( "Micro Museum", RENDER_W * WIN_SCALE, RENDER_H * WIN_SCALE, 0 );
+        SDL_SetWindowPosition( engineContext.window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED );
+
+        if (!engineContext.window)
+        {
+            std::fprintf( stderr, "SDL_CreateWindow: %s\n", SDL_GetError() ); return 1;
+        }
+        engineContext.renderer = SDL_CreateRenderer( engineContext.window, nullptr );     // 2 args in SDL3
+        SDL_SetRenderVSync( engineContext.renderer, replaying ? 0 : 1 );   // optional vsync, off for timing replays
+
+        if (!engineContext.renderer)
+        {
+            std::fprintf( stderr, "SDL_CreateRenderer: %s\n", SDL_GetError() );
+            return 1;
+        }
+        engineContext.backtexure = SDL_CreateTexture( engineContext.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, RENDER_W, RENDER_H );
     }
-    engineContext.renderer = SDL_CreateRenderer( engineContext.window, nullptr );     // 2 args in SDL3
-    SDL_SetRenderVSync( engineContext.renderer, 1 );                   // optional vsync
 
-    if (!engineContext.renderer)
+    engineContext.workers.start( config::renderThreads );
+    engineContext.stripScratch.resize( engineContext.workers.threadCount() );
+    for (auto &scratch : engineContext.stripScratch)
     {
-        std::fprintf( stderr, "SDL_CreateRenderer: %s\n", SDL_GetError() );
-        return 1;
+        scratch.clipTop.assign( RENDER_W, RENDER_H );
+        scratch.clipBot.assign( RENDER_W, -1 );
+        scratch.hits.assign( RENDER_W, WallHit() );
+        scratch.floorTile.assign( RENDER_STRIP_W * RENDER_H, 0 );
     }
-    engineContext.backtexure = SDL_CreateTexture( engineContext.renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, RENDER_W, RENDER_H );
 
 
 
@@ -1082,133 +1193,161 @@ int main( int argc, char **argv ) {
     // Main loop
     bool running = true; 
     Uint32 prev = SDL_GetTicks();
+    int framesRendered = 0;
+    std::vector<std::vector<float>> frameTimes( levels.size() );
     while (running)
     {
+        // Input: polled (and recorded), or the next iteration of the replay. Replays still
+        // poll events, for quitting and window events, and only ignore the keyboard.
+        FrameInput input;
+        if (!replaying)
+        {
+            input.ticks = SDL_GetTicks();
+            input.dt = std::min( (input.ticks - prev) / 1000.0f, 0.05f );
+            prev = input.ticks;
+        }
 
-        Uint32 now = SDL_GetTicks();
-        float dt = (now - prev) / 1000.0f;
-        prev = now;
-        if (dt > 0.05f) dt = 0.05f;
-        // Input
         SDL_Event ev;
-        float actualSpeed;
+        while (SDL_PollEvent( &ev ))
+        {
+            if (ev.type == SDL_EVENT_QUIT)
+            {
+                running = false;
+            }
+            else if (ev.type >= SDL_EVENT_WINDOW_FIRST && ev.type <= SDL_EVENT_WINDOW_LAST)
+            {
+                invalidateFrame( engineContext ); // exposed, resized, restored...
+            }
+            else if (ev.type == SDL_EVENT_KEY_DOWN && !replaying)
+            {
+                input.presses.push_back( Uint16( ev.key.scancode ) );
+            }
+        }
 
+        if (replaying)
+        {
+            if (!readFrameInput( replay, input )) break; // end of the recording
+        }
+        else
+        {
+            const bool *ks = SDL_GetKeyboardState( nullptr );
+            for (int i = 0; i < HELD_KEY_COUNT; ++i)
+            {
+                if (ks[ HELD_KEYS[ i ] ]) input.held |= Uint16( 1 << i );
+            }
+            if (record.is_open()) writeFrameInput( record, input );
+        }
+        const Uint32 now = input.ticks;
+        const float dt = input.dt;
+        float actualSpeed = MOVE_SPEED;
 
         updateMusicStream();
 
-        while (SDL_PollEvent( &ev ))
+        for (Uint16 key : input.presses)
         {
-            actualSpeed = MOVE_SPEED;
-            if (ev.type == SDL_EVENT_QUIT)
+            if (key == SDL_SCANCODE_ESCAPE)
             {
                 running = false;
             }
-            else if (ev.type == SDL_EVENT_KEY_DOWN)
+            else if (key == SDL_SCANCODE_F1)
+            {
+                engineContext.showHelp = !engineContext.showHelp;
+            }
+            else if (key == SDL_SCANCODE_E)
             {
-                if (ev.key.key == SDLK_ESCAPE)
-                {
-                    running = false;
-                }
-                else if (ev.key.key == SDLK_F1)
-                {
-                    engineContext.showHelp = !engineContext.showHelp;
-                }
-                else if (ev.key.scancode == SDL_SCANCODE_E)
-                {
 
-                    int id = pickArtworkUnderCrosshair( engineContext );
-                    if (id < 0) id = findNearestArtwork( engineContext ); // optional fallback
+                int id = pickArtworkUnderCrosshair( engineContext );
+                if (id < 0) id = findNearestArtwork( engineContext ); // optional fallback
 
-                    if (id >= 0) // We are looking at a valid artwork
+                if (id >= 0) // We are looking at a valid artwork
+                {
+                    if (engineContext.placardOpen && engineContext.openArtId == id)
                     {
-                        if (engineContext.placardOpen && engineContext.openArtId == id)
-                        {
-                            // Placard is open -> close it, open journal
-                            engineContext.placardOpen = false;
-                            engineContext.journalOpen = true;
-                            engineContext.lastPlacardTick = SDL_GetTicks(); // Refresh timer
-                        }
-                        else if (engineContext.journalOpen && engineContext.openArtId == id)
-                        {
-                            // Journal is open -> close it
-                            engineContext.journalOpen = false;
-                            engineContext.openArtId = -1; // Fully close
-                        }
-                        else
-                        {
-                            // Nothing is open, or we're looking at a *new* piece of art
-                            // Open the placard for this art
-                            engineContext.openArtId = id;
-                            engineContext.placardOpen = true;
-                            engineContext.journalOpen = false; // Ensure journal is closed
-                            engineContext.lastPlacardTick = SDL_GetTicks();
-
-                          
-                        }
+                        // Placard is open -> close it, open journal
+                        engineContext.placardOpen = false;
+                        engineContext.journalOpen = true;
+                        engineContext.lastPlacardTick = now; // Refresh timer
                     }
-                    else // Not looking at any art
+                    else if (engineContext.journalOpen && engineContext.openArtId == id)
                     {
-                        // Close whatever is open
-                        engineContext.placardOpen = false;
+                        // Journal is open -> close it
                         engineContext.journalOpen = false;
-                        engineContext.openArtId = -1;
-                        if (engineContext.inRangeOfStatue && !engineContext.statueChatActive)
-                        {
-                            engineContext.statueChatActive = true;
-                            engineContext.statueChatStartTick = SDL_GetTicks();
-                        }
+                        engineContext.openArtId = -1; // Fully close
+                    }
+                    else
+                    {
+                        // Nothing is open, or we're looking at a *new* piece of art
+                        // Open the placard for this art
+                        engineContext.openArtId = id;
+                        engineContext.placardOpen = true;
+                        engineContext.journalOpen = false; // Ensure journal is closed
+                        engineContext.lastPlacardTick = now;
+
+                      
                     }
                 }
-                else if (ev.key.scancode == SDL_SCANCODE_F)
-                {
-                    bool toggled = toggleDoorAhead( engineContext );
-					handleLevelChange( engineContext, levels, Levels::CAVE );
-
-                }
-                else if (ev.key.scancode == SDL_SCANCODE_LSHIFT)
-                {
-                    actualSpeed += 0.8f;
-                }
-                else if (ev.key.scancode == SDL_SCANCODE_P)
-                {
-                    float2 pos( engineContext.positionX, engineContext.positionY );
-                    placePlant( engineContext, pos, levels[ curLevel ].folder + "/plant.bmp" );
-                }
-                else if (ev.key.scancode == SDL_SCANCODE_R)
-                {
-                    float2 pos( engineContext.positionX, engineContext.positionY );
-                    placeRope( engineContext, pos, levels[ curLevel ].folder + "/rope.bmp" );
-                }
-                else if (ev.key.scancode == SDL_SCANCODE_T)
-                {
-                    float2 pos( engineContext.positionX, engineContext.positionY );
-                    placeStatue( engineContext, pos, levels[ curLevel ].folder + "/statue.bmp" );
-                }
-                else if (ev.key.scancode == SDL_SCANCODE_V)
-                {
-                    float2 pos( engineContext.positionX, engineContext.positionY );
-                    placeVase( engineContext, pos, levels[ curLevel ].folder );
-                }
-                else if (ev.key.scancode == SDL_SCANCODE_C)
-                {
-                    float2 pos( engineContext.positionX, engineContext.positionY );
-                    placeCan( engineContext, pos, levels[ curLevel ].folder + "/trashcan.bmp" );
-                }
-                else if (ev.key.scancode == SDL_SCANCODE_O)
-                {
-                    saveProps( (levels[ curLevel ].folder + "/props.txt"),
-                        engineContext.props, engineContext.propImages, engineContext.quads );
-                }
-                else if (ev.key.scancode == SDL_SCANCODE_N)
+                else // Not looking at any art
                 {
-					handleLevelChange( engineContext, levels, Levels::TRANSITION );
+                    // Close whatever is open
+                    engineContext.placardOpen = false;
+                    engineContext.journalOpen = false;
+                    engineContext.openArtId = -1;
+                    if (engineContext.inRangeOfStatue && !engineContext.statueChatActive)
+                    {
+                        engineContext.statueChatActive = true;
+                        engineContext.statueChatStartTick = now;
+                    }
                 }
             }
+            else if (key == SDL_SCANCODE_F)
+            {
+                bool toggled = toggleDoorAhead( engineContext );
+                if (toggled) invalidateFrame( engineContext );
+				handleLevelChange( engineContext, levels, Levels::CAVE );
+
+            }
+            else if (key == SDL_SCANCODE_LSHIFT)
+            {
+                actualSpeed += 0.8f;
+            }
+            else if (key == SDL_SCANCODE_P)
+            {
+                float2 pos( engineContext.positionX, engineContext.positionY );
+                placePlant( engineContext, pos, levels[ curLevel ].folder + "/plant.bmp" );
+            }
+            else if (key == SDL_SCANCODE_R)
+            {
+                float2 pos( engineContext.positionX, engineContext.positionY );
+                placeRope( engineContext, pos, levels[ curLevel ].folder + "/rope.bmp" );
+            }
+            else if (key == SDL_SCANCODE_T)
+            {
+                float2 pos( engineContext.positionX, engineContext.positionY );
+                placeStatue( engineContext, pos, levels[ curLevel ].folder + "/statue.bmp" );
+            }
+            else if (key == SDL_SCANCODE_V)
+            {
+                float2 pos( engineContext.positionX, engineContext.positionY );
+                placeVase( engineContext, pos, levels[ curLevel ].folder );
+            }
+            else if (key == SDL_SCANCODE_C)
+            {
+                float2 pos( engineContext.positionX, engineContext.positionY );
+                placeCan( engineContext, pos, levels[ curLevel ].folder + "/trashcan.bmp" );
+            }
+            else if (key == SDL_SCANCODE_O)
+            {
+                saveProps( (levels[ curLevel ].folder + "/props.txt"),
+                    engineContext.props, engineContext.propImages, engineContext.quads );
+            }
+            else if (key == SDL_SCANCODE_N)
+            {
+				handleLevelChange( engineContext, levels, Levels::TRANSITION );
+            }
         }
-        const bool *ks = SDL_GetKeyboardState( nullptr );
         float ms = actualSpeed * dt;
         float ts = TURN_SPEED * dt;
-        if (ks[ SDL_SCANCODE_LEFT ])
+        if (keyHeld( input, SDL_SCANCODE_LEFT ))
         {
             float ang = -ts;
             engineContext.yaw += ang;
@@ -1223,7 +1362,7 @@ int main( int argc, char **argv ) {
             engineContext.planeX = -engineContext.directionY * FOV_TAN;
             engineContext.planeY = engineContext.directionX * FOV_TAN;
         }
-        if (ks[ SDL_SCANCODE_RIGHT ])
+        if (keyHeld( input, SDL_SCANCODE_RIGHT ))
         {
             float ang = ts;
             engineContext.yaw += ang;
@@ -1239,23 +1378,23 @@ int main( int argc, char **argv ) {
         }
         // move: W/S
         float nx = engineContext.positionX, ny = engineContext.positionY;
-        if (ks[ SDL_SCANCODE_W ])
+        if (keyHeld( input, SDL_SCANCODE_W ))
         {
             nx += engineContext.directionX * ms;
             ny += engineContext.directionY * ms;
         }
-        if (ks[ SDL_SCANCODE_S ])
+        if (keyHeld( input, SDL_SCANCODE_S ))
         {
             nx -= engineContext.directionX * ms;
             ny -= engineContext.directionY * ms;
         }
         // strafe: A/D
-        if (ks[ SDL_SCANCODE_A ])
+        if (keyHeld( input, SDL_SCANCODE_A ))
         {
             nx += engineContext.directionY * ms;
             ny += -engineContext.directionX * ms;
         }
-        if (ks[ SDL_SCANCODE_D ])
+        if (keyHeld( input, SDL_SCANCODE_D ))
         {
             nx += -engineContext.directionY * ms;
             ny += engineContext.directionX * ms;
@@ -1307,8 +1446,7 @@ int main( int argc, char **argv ) {
         engineContext.inRangeOfStatue = isPlayerNearStatue( engineContext );
         if (engineContext.statueChatActive)
         {
-            Uint32 now = SDL_GetTicks();
-            if (now - engineContext.statueChatStartTick > 8000)
+            if (now - engineContext.statueChatStartTick > STATUE_CHAT_MS)
             {
                 engineContext.statueChatActive = false; // Reset state
                 handleLevelChange( engineContext, levels, Levels::TRANSITION );
@@ -1316,10 +1454,7 @@ int main( int argc, char **argv ) {
         }
         {
             // Keep open while you keep looking at it; close after ~600ms of looking away
-            static const Uint32 KEEP_MS = 600;
-
             int under = pickArtworkUnderCrosshair( engineContext );
-            Uint32 now = SDL_GetTicks();
 
             if (engineContext.placardOpen)
             {
@@ -1327,22 +1462,50 @@ int main( int argc, char **argv ) {
                 {
                     engineContext.lastPlacardTick = now; // still looking at it: refresh timer
                 }
-                else if (now - engineContext.lastPlacardTick > KEEP_MS)
+                else if (now - engineContext.lastPlacardTick > PLACARD_KEEP_MS)
                 {
                     engineContext.placardOpen = false;
                     engineContext.openArtId = -1;
                 }
             }
         }
-        render( engineContext, dt );
 
-        // Present to window (nearest-neighbor scale)
-        SDL_UpdateTexture( engineContext.backtexure, nullptr, engineContext.backbuffer.data(), RENDER_W * 4 );
-        SDL_RenderClear( engineContext.renderer );
-        SDL_RenderTexture( engineContext.renderer, engineContext.backtexure, nullptr, nullptr );
-        SDL_RenderPresent( engineContext.renderer );
+        // Nothing on screen would change: keep the frame and sleep until something happens.
+        // The clock restarts on waking, so the next frame doesn't see the sleep as dt.
+        if (frameIsStatic( engineContext ))
+        {
+            flushPresentQueue( engineContext );
+            SDL_WaitEventTimeout( nullptr, idleWaitMs( engineContext, SDL_GetTicks() ) );
+            prev = SDL_GetTicks();
+            continue;
+        }
+        // A still view shown scaled down renders once more at full size, then idles
+        if (frameIsCurrent( engineContext )) changeResolutionLevel( engineContext, 0 );
+        const auto frameStart = std::chrono::steady_clock::now();
+        renderAndPresent( engineContext, dt );
+        keepFrameState( engineContext );
+        if (benchmarking)
+        {
+            const float frameMs = std::chrono::duration<float, std::milli>( std::chrono::steady_clock::now() - frameStart ).count();
+            frameTimes[ engineContext.currentLevel ].push_back( frameMs );
+        }
+        if (!options.dumpDir.empty())
+        {
+            char name[ 32 ];
+            std::snprintf( name, sizeof( name ), "frame_%05d.ppm", framesRendered );
+            writePPM( (std::filesystem::path( options.dumpDir ) / name).string(), lastRenderedFrame( engineContext ) );
+        }
+        if (++framesRendered == options.frames) running = false;
+    }
+
+    if (benchmarking)
+    {
+        std::vector<std::string> levelNames;
+        for (const auto &level : levels) levelNames.push_back( level.name );
+        reportFrameTimes( frameTimes, levelNames );
     }
 
+    engineContext.workers.stop();
     SDL_DestroyTexture( engineContext.backtexure );
     SDL_DestroyRenderer( engineContext.renderer );
     SDL_DestroyWindow( engineContext.window );